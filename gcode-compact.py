@@ -0,0 +1,166 @@
+#!/usr/bin/env python
+"""\
+Convert a g-code file to the compact binary format that the player can play from the sd card
+
+G0 and G1 moves are stored as the change in each word from its last value, as fixed point varints,
+everything else is kept as a text line. The format is described in src/modules/utils/player/CompactGcode.h
+
+Usage: gcode-compact.py [-d decimals] file.gcode [out.bgc]
+"""
+
+from __future__ import print_function
+import sys
+import re
+import struct
+import argparse
+
+MAGIC = b'SGCB'
+VERSION = 1
+
+OP_TEXT = 0x01
+OP_MOVE = 0x10
+
+# word order in a move record, the first 8 are the mask bits, S is flagged in the opcode
+WORDS = 'XYZABCEF'
+MAX_LINE = 128
+
+word_re = re.compile(r'\s*([A-Z])\s*([-+]?(?:\d+\.?\d*|\.\d+))')
+
+
+def varint(v):
+    out = bytearray()
+    while True:
+        b = v & 0x7F
+        v >>= 7
+        if v:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def zigzag(v):
+    return (v << 1) ^ (v >> 31)
+
+
+def strip_comments(line):
+    line = line.split(';', 1)[0]
+    return re.sub(r'\([^)]*\)', '', line).strip()
+
+
+def parse_words(line):
+    """returns the words of the line as a list of (letter, text), or None if it is not just words"""
+    words = []
+    pos = 0
+    while pos < len(line):
+        m = word_re.match(line, pos)
+        if m is None:
+            return None
+        words.append((m.group(1), m.group(2)))
+        pos = m.end()
+    return words
+
+
+class Converter:
+    def __init__(self, decimals):
+        self.scale = 10 ** decimals
+        self.last = {c: 0 for c in WORDS + 'S'}
+        self.modal = 0
+        self.moves = 0
+        self.texts = 0
+        self.skipped = 0
+
+    def move(self, g, words):
+        """encodes a G0/G1 move, or returns None if it cannot be"""
+        values = {}
+        for letter, text in words:
+            if (letter not in WORDS and letter != 'S') or letter in values:
+                return None
+            v = int(round(float(text) * self.scale))
+            if not -2**31 <= v < 2**31:
+                return None
+            values[letter] = v
+
+        mask = 0
+        data = bytearray()
+        for i, c in enumerate(WORDS + 'S'):
+            if c not in values:
+                continue
+            d = values[c] - self.last[c]
+            if not -2**31 <= d < 2**31:
+                return None
+            if c != 'S':
+                mask |= 1 << i
+            data += varint(zigzag(d))
+
+        for c, v in values.items():
+            self.last[c] = v
+        op = OP_MOVE | g | (0x02 if 'S' in values else 0)
+        return bytes(bytearray([op, mask])) + bytes(data)
+
+    def line(self, text):
+        line = strip_comments(text)
+        if not line:
+            return b''
+
+        words = parse_words(line)
+        if words is not None:
+            g = None
+            if words[0][0] == 'G' and words[0][1] in ('0', '00', '1', '01'):
+                g = int(words[0][1])
+                words = words[1:]
+            elif words[0][0] in 'XYZF' and self.modal < 2:
+                # no G, the dispatcher uses the last G0 to G3, and G1 for just an F
+                g = 1 if words[0][0] == 'F' else self.modal
+
+            if g is not None:
+                rec = self.move(g, words)
+                if rec is not None:
+                    self.modal = g
+                    self.moves += 1
+                    return rec
+
+            # track the motion mode for lines that have no G
+            for letter, value in words:
+                if letter == 'G' and float(value) in (0, 1, 2, 3):
+                    self.modal = int(float(value))
+
+        # anything else is played as it was written
+        raw = text.rstrip('\r\n').encode('ascii', 'replace')
+        if len(raw) > MAX_LINE:
+            print('Warning: discarded long line: {}'.format(raw[:40]), file=sys.stderr)
+            self.skipped += 1
+            return b''
+
+        self.texts += 1
+        return bytes(bytearray([OP_TEXT])) + varint(len(raw)) + raw
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Convert g-code to the compact binary format for playing from the sd card.')
+    parser.add_argument('gcode_file', type=argparse.FileType('r'), help='g-code file to convert')
+    parser.add_argument('out_file', nargs='?', help='output file, defaults to the input with .bgc')
+    parser.add_argument('-d', '--decimals', type=int, default=4, choices=range(0, 7),
+                        help='decimals to keep for each word, default 4')
+    args = parser.parse_args()
+
+    out_name = args.out_file
+    if out_name is None:
+        out_name = re.sub(r'\.[^./\\]*$', '', args.gcode_file.name) + '.bgc'
+
+    conv = Converter(args.decimals)
+    size_in = 0
+    with open(out_name, 'wb') as out:
+        out.write(MAGIC + struct.pack('<BBH', VERSION, args.decimals, 0))
+        for line in args.gcode_file:
+            size_in += len(line)
+            out.write(conv.line(line))
+        size_out = out.tell()
+
+    print('{}: {} moves, {} text lines, {} discarded, {} -> {} bytes ({:.1f}x)'.format(
+        out_name, conv.moves, conv.texts, conv.skipped, size_in, size_out,
+        float(size_in) / size_out if size_out else 0))
+
+
+if __name__ == '__main__':
+    main()
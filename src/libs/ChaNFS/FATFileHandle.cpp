@@ -32,11 +32,13 @@ static const char *FR_ERRORS[] = {
 
 FATFileHandle::FATFileHandle(FIL_t fh) {
     _fh = fh;
+    _no_link_map = false;
 }
     
 int FATFileHandle::close() {
     FFSDEBUG("close\n");
     int retval = f_close(&_fh);
+    free(_fh.cltbl);
     delete this;
     return retval;
 }
@@ -74,6 +76,9 @@ off_t FATFileHandle::lseek(off_t position, int whence) {
     } else if(whence==SEEK_CUR) {
         position += _fh.fptr;
     }
+    if(position != 0 && position != (off_t)_fh.fptr && _fh.cltbl == NULL && !_no_link_map) {
+        _no_link_map = !create_link_map();
+    }
     FRESULT res = f_lseek(&_fh, position);
     if(res) {
         FFSDEBUG("lseek failed (%d, %s)\n", res, FR_ERRORS[res]);
@@ -94,6 +99,34 @@ int FATFileHandle::fsync() {
     return 0;
 }
 
+// Read only files get a cluster link map the first time they seek anywhere but the start, walking the FAT
+// chain once, then any later seek (and reading on into the next cluster) looks the cluster up in the map
+// rather than following the chain from the start of the file, so resuming far into a big file is quick.
+bool FATFileHandle::create_link_map() {
+    if(_fh.flag & FA_WRITE) return false; // fast seek mode cannot grow the file
+
+    // a map is two words per fragment plus three, start with room for a fairly fragmented file
+    DWORD size = 32;
+    for(int tries = 0; tries < 2; tries++) {
+        DWORD *tbl = (DWORD *)malloc(size * sizeof(DWORD));
+        if(tbl == NULL) return false;
+        tbl[0] = size;
+        _fh.cltbl = tbl;
+        FRESULT res = f_lseek(&_fh, CREATE_LINKMAP);
+        if(res == FR_OK) {
+            FFSDEBUG("link map of %d words\n", tbl[0]);
+            return true;
+        }
+
+        // too small, the size it needs is in the first word, give up on files in hundreds of pieces
+        _fh.cltbl = NULL;
+        size = tbl[0];
+        free(tbl);
+        if(res != FR_NOT_ENOUGH_CORE || size > 512) return false;
+    }
+    return false;
+}
+
 off_t FATFileHandle::flen() {
     FFSDEBUG("flen\n");
     return _fh.fsize;
@@ -24,7 +24,10 @@ public:
 
 protected:
 
+    bool create_link_map();
+
     FIL_t _fh;
+    bool _no_link_map;
 
 };
 
@@ -142,4 +142,25 @@ int FATFileSystem::mkdir(const char *name, mode_t mode) {
     return res == 0 ? 0 : -1;
 }
 
+// a sector at a time unless the disk can do better
+int FATFileSystem::disk_read_sectors(char *buffer, int sector, int count) {
+    for(int i=0; i<count; i++) {
+        int res = disk_read(buffer + i * 512, sector + i);
+        if(res) {
+            return res;
+        }
+    }
+    return 0;
+}
+
+int FATFileSystem::disk_write_sectors(const char *buffer, int sector, int count) {
+    for(int i=0; i<count; i++) {
+        int res = disk_write(buffer + i * 512, sector + i);
+        if(res) {
+            return res;
+        }
+    }
+    return 0;
+}
+
 } // namespace mbed
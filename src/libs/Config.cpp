@@ -20,6 +20,11 @@ using namespace std;
 #include "libs/ConfigSources/FileConfigSource.h"
 #include "libs/ConfigSources/FirmConfigSource.h"
 #include "StreamOutputPool.h"
+#include "checksumm.h"
+
+#define config_blob_enable_checksum CHECKSUM("config_blob_enable")
+
+static const char *config_blob_file = "/sd/config.bin";
 
 // Add various config sources. Config can be fetched from several places.
 // All values are read into a cache, that is then used by modules to read their configuration
@@ -76,13 +81,73 @@ void Config::config_cache_load(bool parse)
 
     this->config_cache= new ConfigCache;
     if(parse) {
+        FILE *fp = fopen(config_blob_file, "r");
+        bool blob_found = fp != NULL;
+        bool loaded = blob_found && load_blob(fp);
+        if(blob_found) fclose(fp);
+        if(loaded) return;
+
         // For each ConfigSource in our stack
         for( ConfigSource *source : this->config_sources ) {
             source->transfer_values_to_cache(this->config_cache);
         }
+
+        if(value(config_blob_enable_checksum)->by_default(false)->as_bool()) {
+            save_blob();
+        } else if(blob_found) {
+            remove(config_blob_file);
+        }
     }
 }
 
+// With config_blob_enable set the parsed config is also saved in binary form, and later boots read that instead of
+// parsing the sources as long as none of them has changed since. The blob starts with a stamp for each source
+
+bool Config::get_stamps(vector<uint32_t> &stamps)
+{
+    for( ConfigSource *source : this->config_sources ) {
+        uint32_t stamp = source->get_stamp();
+        if(stamp == 0) return false;
+        stamps.push_back(stamp);
+    }
+    return true;
+}
+
+bool Config::load_blob(FILE *fp)
+{
+    vector<uint32_t> stamps;
+    bool ok = get_stamps(stamps);
+
+    uint32_t n;
+    ok = ok && fread(&n, sizeof(n), 1, fp) == 1 && n == stamps.size();
+    for (size_t i = 0; ok && i < n; i++) {
+        uint32_t stamp;
+        ok = fread(&stamp, sizeof(stamp), 1, fp) == 1 && stamp == stamps[i];
+    }
+    ok = ok && this->config_cache->load(fp);
+
+    if(!ok) {
+        // start again with an empty cache
+        delete this->config_cache;
+        this->config_cache= new ConfigCache;
+    }
+    return ok;
+}
+
+void Config::save_blob()
+{
+    vector<uint32_t> stamps;
+    if(!get_stamps(stamps)) return;
+
+    FILE *fp = fopen(config_blob_file, "w");
+    if(fp == NULL) return;
+
+    uint32_t n = stamps.size();
+    bool ok = fwrite(&n, sizeof(n), 1, fp) == 1 && fwrite(stamps.data(), sizeof(uint32_t), n, fp) == n && this->config_cache->save(fp);
+    fclose(fp);
+    if(!ok) remove(config_blob_file);
+}
+
 // Command to clear the config cache after init
 void Config::config_cache_clear()
 {
@@ -12,6 +12,8 @@
 using namespace std;
 #include <vector>
 #include <string>
+#include <stdint.h>
+#include <stdio.h>
 
 class ConfigValue;
 class ConfigSource;
@@ -37,6 +39,9 @@ class Config  {
 
     private:
         bool   has_characters(uint16_t check_sum, string str );
+        bool   get_stamps(vector<uint32_t> &stamps);
+        bool   load_blob(FILE *fp);
+        void   save_blob();
 
         ConfigCache* config_cache;            // A cache in which ConfigValues are kept
         vector<ConfigSource*> config_sources; // A list of all possible coniguration sources
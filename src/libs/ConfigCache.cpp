@@ -2,6 +2,12 @@
 #include "ConfigValue.h"
 
 #include "libs/StreamOutput.h"
+#include "libs/utils.h"
+
+#include <algorithm>
+#include <string.h>
+
+const uint16_t ConfigCache::empty_slot;
 
 ConfigCache::ConfigCache()
 {
@@ -19,11 +25,19 @@ void ConfigCache::clear()
     }
     store.clear();
     storage_t().swap(store);   //  makes sure the vector releases its memory
+    vector<uint16_t>().swap(index);
+    vector<uint16_t>().swap(families);
 }
 
 void ConfigCache::add(ConfigValue *v)
 {
     store.push_back(v);
+    families.clear();
+    if(store.size() * 2 > index.size()) {
+        rebuild_index(index.empty() ? 64 : index.size() * 2);
+    } else {
+        index_add(store.size() - 1);
+    }
 }
 
 void ConfigCache::pop()
@@ -31,47 +45,144 @@ void ConfigCache::pop()
     auto cv= store.back();
     store.pop_back();
     delete cv;
+    // only used to drop an include line just added, so rebuilding is rare
+    families.clear();
+    rebuild_index(index.size());
+}
+
+uint32_t ConfigCache::hash(const uint16_t *check_sums)
+{
+    uint32_t h = check_sums[0] * 0x9E3779B1U ^ check_sums[1] * 0x85EBCA77U ^ check_sums[2] * 0xC2B2AE3DU;
+    return h ^ (h >> 16);
+}
+
+// position in store of the value matching the check sums, or -1
+int ConfigCache::find(const uint16_t *check_sums) const
+{
+    if(index.empty()) return -1;
+
+    size_t mask = index.size() - 1;
+    for(size_t i = hash(check_sums) & mask; index[i] != empty_slot; i = (i + 1) & mask) {
+        if(memcmp(check_sums, store[index[i]]->check_sums, sizeof(store[index[i]]->check_sums)) == 0)
+            return index[i];
+    }
+    return -1;
+}
+
+void ConfigCache::index_add(uint16_t pos)
+{
+    size_t mask = index.size() - 1;
+    size_t i = hash(store[pos]->check_sums) & mask;
+    while(index[i] != empty_slot) i = (i + 1) & mask;
+    index[i] = pos;
+}
+
+// size must be a power of two
+void ConfigCache::rebuild_index(size_t size)
+{
+    index.assign(size, empty_slot);
+    for(size_t pos = 0; pos < store.size(); pos++) {
+        index_add(pos);
+    }
+}
+
+void ConfigCache::build_families()
+{
+    families.resize(store.size());
+    for(size_t pos = 0; pos < store.size(); pos++) {
+        families[pos] = pos;
+    }
+    std::stable_sort(families.begin(), families.end(), [this](uint16_t a, uint16_t b) { return store[a]->check_sums[0] < store[b]->check_sums[0]; });
 }
 
 // If we find an existing value, replace it, otherwise, push it at the back of the list
 void ConfigCache::replace_or_push_back(ConfigValue *new_value)
 {
-    // For each already existing element
-    for(auto &cv : store) {
-        // If this configvalue matches the checksum
-        if(memcmp(new_value->check_sums, cv->check_sums, sizeof(cv->check_sums)) == 0) {
-            // Replace with the provided value
-            delete cv; // free up old one
-            cv =  new_value;
-            printf("WARNING: duplicate config line replaced\n");
-            return;
-        }
+    // If this configvalue matches the checksum of an existing one
+    int pos = find(new_value->check_sums);
+    if(pos >= 0) {
+        // Replace with the provided value, it keeps its place in the index
+        delete store[pos]; // free up old one
+        store[pos] = new_value;
+        printf("WARNING: duplicate config line replaced\n");
+        return;
     }
 
     // Value does not already exists, add to the list
-    store.push_back(new_value);
+    add(new_value);
 }
 
 ConfigValue *ConfigCache::lookup(const uint16_t *check_sums) const
 {
-    for( auto &cv : store) {
-        if(memcmp(check_sums, cv->check_sums, sizeof(cv->check_sums)) == 0)
-            return cv;
-    }
-
-    return NULL;
+    int pos = find(check_sums);
+    return pos < 0 ? NULL : store[pos];
 }
 
 void ConfigCache::collect(uint16_t family, uint16_t cs, vector<uint16_t> *list)
 {
-    for( auto &kv : store ) {
-        if( kv->check_sums[2] == cs && kv->check_sums[0] == family ) {
+    if(families.size() != store.size()) build_families();
+
+    // the values of the family are together and in the order they were added
+    auto first = std::lower_bound(families.begin(), families.end(), family, [this](uint16_t pos, uint16_t f) { return store[pos]->check_sums[0] < f; });
+    for(auto i = first; i != families.end() && store[*i]->check_sums[0] == family; ++i) {
+        if( store[*i]->check_sums[2] == cs ) {
             // We found a module enable for this family, add it's number
-            list->push_back(kv->check_sums[1]);
+            list->push_back(store[*i]->check_sums[1]);
         }
     }
 }
 
+// each value is its three check sums, the length of the value and the value, the last 4 bytes are a hash of the rest
+bool ConfigCache::save(FILE *fp) const
+{
+    uint32_t hash = hash_bytes(NULL, 0);
+    uint16_t n = store.size();
+    hash = hash_bytes(&n, sizeof(n), hash);
+    if(fwrite(&n, sizeof(n), 1, fp) != 1) return false;
+
+    for( auto &cv : store ) {
+        uint8_t len = cv->value.size() < 255 ? cv->value.size() : 255;
+        hash = hash_bytes(cv->check_sums, sizeof(cv->check_sums), hash);
+        hash = hash_bytes(&len, 1, hash);
+        hash = hash_bytes(cv->value.data(), len, hash);
+        if(fwrite(cv->check_sums, sizeof(cv->check_sums), 1, fp) != 1 || fwrite(&len, 1, 1, fp) != 1 ||
+           fwrite(cv->value.data(), 1, len, fp) != len) {
+            return false;
+        }
+    }
+
+    return fwrite(&hash, sizeof(hash), 1, fp) == 1;
+}
+
+bool ConfigCache::load(FILE *fp)
+{
+    uint32_t hash = hash_bytes(NULL, 0);
+    uint16_t n;
+    if(fread(&n, sizeof(n), 1, fp) != 1) return false;
+    hash = hash_bytes(&n, sizeof(n), hash);
+
+    store.reserve(n);
+    for (uint16_t i = 0; i < n; i++) {
+        uint16_t check_sums[3];
+        uint8_t len;
+        char buf[255];
+        if(fread(check_sums, sizeof(check_sums), 1, fp) != 1 || fread(&len, 1, 1, fp) != 1 || fread(buf, 1, len, fp) != len) {
+            return false;
+        }
+        hash = hash_bytes(check_sums, sizeof(check_sums), hash);
+        hash = hash_bytes(&len, 1, hash);
+        hash = hash_bytes(buf, len, hash);
+
+        ConfigValue *cv = new ConfigValue(check_sums);
+        cv->found = true;
+        cv->value.assign(buf, len);
+        add(cv);
+    }
+
+    uint32_t check;
+    return fread(&check, sizeof(check), 1, fp) == 1 && check == hash;
+}
+
 void ConfigCache::dump(StreamOutput *stream)
 {
     int l = 1;
@@ -11,6 +11,7 @@
 using namespace std;
 #include <vector>
 #include <stdint.h>
+#include <stdio.h>
 #include <map>
 
 class ConfigValue;
@@ -37,9 +38,27 @@ class ConfigCache {
         // used for debugging, dumps the cache to a stream
         void dump(StreamOutput *stream);
 
+        // writes the values in a binary form followed by a check on them, and reads them back into an empty cache,
+        // returns false on any error
+        bool save(FILE *fp) const;
+        bool load(FILE *fp);
+
     private:
         typedef vector<ConfigValue*> storage_t;
         storage_t store;
+
+        // open addressing hash table on the three check sums, each slot is a position in store or empty_slot,
+        // it is kept no more than half full and grows as values are added
+        static const uint16_t empty_slot = 0xFFFF;
+        static uint32_t hash(const uint16_t *check_sums);
+        int find(const uint16_t *check_sums) const;
+        void index_add(uint16_t pos);
+        void rebuild_index(size_t size);
+        vector<uint16_t> index;
+
+        // positions in store ordered by family (first check sum) and then as they were added, for collect()
+        void build_families();
+        vector<uint16_t> families;
 };
 
 
@@ -23,6 +23,8 @@ class ConfigSource {
         virtual bool is_named( uint16_t check_sum ) = 0;
         virtual bool write( std::string setting, std::string value ) = 0;
         virtual std::string read( uint16_t check_sums[3] ) = 0;
+        // Identifies what the source holds without parsing it, for checking a saved copy of the parsed config, 0 if unknown
+        virtual uint32_t get_stamp() { return 0; }
 
     protected:
         virtual ConfigValue* process_line_from_ascii_config(const std::string& line, ConfigCache* cache);
@@ -24,6 +24,7 @@ FileConfigSource::FileConfigSource(string config_file, const char *name)
     this->name_checksum = get_checksum(name);
     this->config_file = config_file;
     this->config_file_found = false;
+    this->has_includes = false;
 }
 
 bool FileConfigSource::readLine(string& line, int lineno, FILE *fp)
@@ -55,9 +56,31 @@ void FileConfigSource::transfer_values_to_cache( ConfigCache *cache )
     if( !this->has_config_file() ) {
         return;
     }
+    this->has_includes = false;
     transfer_values_to_cache( cache, this->get_config_file().c_str());
 }
 
+// A hash of the file, reading it is much quicker than parsing it. Its modification time is no use here as files
+// written by the firmware all get the same one
+uint32_t FileConfigSource::get_stamp()
+{
+    if( this->has_includes || !this->has_config_file() ) {
+        return 0;
+    }
+
+    FILE *lp = fopen(this->get_config_file().c_str(), "r");
+    if(lp == NULL) return 0;
+
+    char buf[256];
+    uint32_t stamp = hash_bytes(NULL, 0);
+    size_t n;
+    while((n = fread(buf, 1, sizeof(buf), lp)) > 0) {
+        stamp = hash_bytes(buf, n, stamp);
+    }
+    fclose(lp);
+    return stamp;
+}
+
 void FileConfigSource::transfer_values_to_cache( ConfigCache *cache, const char * file_name )
 {
     if( !file_exists(file_name) ) {
@@ -81,6 +104,7 @@ void FileConfigSource::transfer_values_to_cache( ConfigCache *cache, const char
             if(cv->check_sums[0] == include_checksum) {
                 string inc_file_name = cv->value.c_str();
                 cache->pop(); // we do not need to keep this around or leave it on the list
+                this->has_includes = true;
 
                 if(!file_exists(inc_file_name)) {
                     // if the file is not found at the location entered then look around for it a bit
@@ -55,6 +55,11 @@ bool FirmConfigSource::is_named( uint16_t check_sum ){
     return check_sum == this->name_checksum;
 }
 
+// It is in flash, so hashing it is quick
+uint32_t FirmConfigSource::get_stamp(){
+    return hash_bytes(this->start, this->end - this->start);
+}
+
 // Write a config setting to the file *** FirmConfigSource is read only ***
 bool FirmConfigSource::write( string setting, string value ){
     //THEKERNEL->streams->printf("ERROR: FirmConfigSource is read only\r\n");
@@ -26,6 +26,7 @@ public:
     bool is_named( uint16_t check_sum );
     bool write( string setting, string value );
     string read( uint16_t check_sums[3] );
+    uint32_t get_stamp();
 
 private:
     const char *start, *end;
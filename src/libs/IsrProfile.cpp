@@ -0,0 +1,97 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef ISR_PROFILE
+
+#include "IsrProfile.h"
+#include "StreamOutput.h"
+
+#include "libs/LPC17xx/sLPC17xx.h"
+#include "system_LPC17xx.h" // for SystemCoreClock
+#include "us_ticker_api.h"
+
+IsrProfile *IsrProfile::list = nullptr;
+uint32_t IsrProfile::reset_time = 0;
+
+// profiles are static objects so they all register here before main() runs
+IsrProfile::IsrProfile(const char *name) : name(name)
+{
+    // start the cycle counter, it is only running when a debugger has turned it on
+    ISR_PROFILE_DEMCR |= 1 << 24;    // TRCENA
+    ISR_PROFILE_DWT_CYCCNT = 0;
+    ISR_PROFILE_DWT_CTRL |= 1 << 0;  // CYCCNTENA
+
+    reset();
+    next = list;
+    list = this;
+}
+
+void IsrProfile::reset()
+{
+    __disable_irq();
+    count = 0;
+    min = UINT32_MAX;
+    max = 0;
+    total = 0;
+    for (uint32_t i = 0; i < n_buckets; ++i) {
+        buckets[i] = 0;
+    }
+    __enable_irq();
+}
+
+void IsrProfile::report(StreamOutput *stream, uint32_t elapsed_us) const
+{
+    // take a consistent copy as the interrupts keep recording
+    __disable_irq();
+    uint32_t n = count, lo = min, hi = max;
+    uint64_t sum = total;
+    uint32_t hist[n_buckets];
+    for (uint32_t i = 0; i < n_buckets; ++i) {
+        hist[i] = buckets[i];
+    }
+    __enable_irq();
+
+    if(n == 0) {
+        stream->printf("%s: no calls\n", name);
+        return;
+    }
+
+    float cycles_per_us = SystemCoreClock / 1000000.0F;
+    float load = elapsed_us > 0 ? 100.0F * sum / (elapsed_us * cycles_per_us) : 0;
+    stream->printf("%s: calls %lu, cycles min %lu avg %lu max %lu (max %1.2f us), load %1.2f%%\n",
+                   name, n, lo, (uint32_t)(sum / n), hi, hi / cycles_per_us, load);
+
+    stream->printf("  <64:%lu", hist[0]);
+    for (uint32_t i = 1; i < n_buckets; ++i) {
+        if(hist[i] == 0) continue;
+        if(i == n_buckets - 1) {
+            stream->printf(" >=%lu:%lu", 64UL << (i - 1), hist[i]);
+        } else {
+            stream->printf(" <%lu:%lu", 64UL << i, hist[i]);
+        }
+    }
+    stream->printf("\n");
+}
+
+void IsrProfile::reset_all()
+{
+    for (IsrProfile *p = list; p != nullptr; p = p->next) {
+        p->reset();
+    }
+    reset_time = us_ticker_read();
+}
+
+void IsrProfile::report_all(StreamOutput *stream)
+{
+    uint32_t elapsed_us = us_ticker_read() - reset_time;
+    stream->printf("cycles at %lu MHz over %1.3f s\n", SystemCoreClock / 1000000, elapsed_us / 1e6F);
+    for (IsrProfile *p = list; p != nullptr; p = p->next) {
+        p->report(stream, elapsed_us);
+    }
+}
+
+#endif
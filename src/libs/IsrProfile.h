@@ -0,0 +1,82 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+// Optional cycle counting for interrupt handlers and other hot paths, only built with make ISR_PROFILE=1.
+// Each profile keeps min/avg/max and a histogram of the cycles spent per call, read from the DWT cycle counter.
+// The times include any higher priority interrupts that preempted the profiled code.
+// Use the profile command to see them.
+
+#ifdef ISR_PROFILE
+
+#include <stdint.h>
+
+// the smoothed sLPC17xx.h has no DWT so the Cortex-M3 debug registers are addressed directly
+#define ISR_PROFILE_DEMCR      (*(volatile uint32_t *)0xE000EDFC)
+#define ISR_PROFILE_DWT_CTRL   (*(volatile uint32_t *)0xE0001000)
+#define ISR_PROFILE_DWT_CYCCNT (*(volatile uint32_t *)0xE0001004)
+
+class StreamOutput;
+
+class IsrProfile {
+    public:
+        IsrProfile(const char *name);
+
+        void record(uint32_t cycles)
+        {
+            ++count;
+            total += cycles;
+            if(cycles < min) min = cycles;
+            if(cycles > max) max = cycles;
+
+            // bucket 0 is under 64 cycles, then one per power of two, the last one has everything above
+            uint32_t b = (cycles < 64) ? 0 : 32 - __builtin_clz(cycles >> 6);
+            ++buckets[b < n_buckets ? b : n_buckets - 1];
+        }
+
+        void reset();
+        void report(StreamOutput *stream, uint32_t elapsed_us) const;
+
+        static void reset_all();
+        static void report_all(StreamOutput *stream);
+
+    private:
+        static const uint32_t n_buckets = 12;
+
+        static IsrProfile *list;
+        static uint32_t reset_time;
+
+        IsrProfile *next;
+        const char *name;
+        uint32_t count;
+        uint32_t min;
+        uint32_t max;
+        uint64_t total;
+        uint32_t buckets[n_buckets];
+};
+
+// records the cycles from here to the end of the enclosing scope
+class IsrProfileScope {
+    public:
+        IsrProfileScope(IsrProfile &profile) : profile(profile), start(ISR_PROFILE_DWT_CYCCNT) {}
+        ~IsrProfileScope() { profile.record(ISR_PROFILE_DWT_CYCCNT - start); }
+
+    private:
+        IsrProfile &profile;
+        uint32_t start;
+};
+
+#define ISR_PROFILE_DEFINE(var, name) static IsrProfile var(name)
+#define ISR_PROFILE_SCOPE(var) IsrProfileScope isr_profile_scope(var)
+
+#else
+
+#define ISR_PROFILE_DEFINE(var, name)
+#define ISR_PROFILE_SCOPE(var)
+
+#endif
@@ -50,6 +50,7 @@
 #define grbl_mode_checksum CHECKSUM("grbl_mode")
 #define feed_hold_enable_checksum CHECKSUM("enable_feed_hold")
 #define ok_per_line_checksum CHECKSUM("ok_per_line")
+#define report_buffers_checksum CHECKSUM("report_buffers")
 
 Kernel *Kernel::instance;
 
@@ -123,6 +124,9 @@ Kernel::Kernel()
     // we expect ok per line now not per G code, setting this to false will return to the old (incorrect) way of ok per G code
     this->ok_per_line = this->config->value(ok_per_line_checksum)->by_default(true)->as_bool();
 
+    // add the free planner blocks and receive buffer bytes to ok and the status report, so a host can stream ahead
+    this->report_buffers = this->config->value(report_buffers_checksum)->by_default(false)->as_bool();
+
     this->add_module(this->serial);
 
     // HAL stuff
@@ -191,7 +195,7 @@ Kernel::Kernel()
 }
 
 // return a GRBL-like query string for serial ?
-std::string Kernel::get_query_string()
+std::string Kernel::get_query_string(StreamOutput *stream)
 {
     std::string str;
     bool homing;
@@ -347,6 +351,21 @@ std::string Kernel::get_query_string()
         }
     }
 
+    if (report_buffers)
+    {
+        // free planner blocks, and free receive buffer bytes of the stream asking if it knows them
+        char buf[32];
+        int rx = stream == nullptr ? -1 : stream->rx_free();
+        size_t n;
+        if (rx >= 0)
+            n = snprintf(buf, sizeof(buf), "|Bf:%u,%d", (unsigned)conveyor->get_queue_free(), rx);
+        else
+            n = snprintf(buf, sizeof(buf), "|Bf:%u", (unsigned)conveyor->get_queue_free());
+        if (n > sizeof(buf))
+            n = sizeof(buf);
+        str.append(buf, n);
+    }
+
     str.append(">\n");
     return str;
 }
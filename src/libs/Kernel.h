@@ -32,6 +32,7 @@ class Adc;
 class PublicData;
 class SimpleShell;
 class Configurator;
+class StreamOutput;
 
 class Kernel
 {
@@ -52,6 +53,7 @@ public:
     bool is_canceled() const { return canceled; }
     bool is_grbl_mode() const { return grbl_mode; }
     bool is_ok_per_line() const { return ok_per_line; }
+    bool is_report_buffers() const { return report_buffers; }
 
     void set_feed_hold(bool f) { feed_hold = f; }
     bool get_feed_hold() const { return feed_hold; }
@@ -59,7 +61,7 @@ public:
     void set_bad_mcu(bool b) { bad_mcu = b; }
     bool is_bad_mcu() const { return bad_mcu; }
 
-    std::string get_query_string();
+    std::string get_query_string(StreamOutput *stream = nullptr);
 
     // These modules are available to all other modules
     SerialConsole *serial;
@@ -91,6 +93,7 @@ private:
         bool ok_per_line : 1;
         bool enable_feed_hold : 1;
         bool bad_mcu : 1;
+        bool report_buffers : 1;
     };
 };
 
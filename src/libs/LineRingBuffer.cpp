@@ -0,0 +1,114 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "LineRingBuffer.h"
+
+#include "platform_memory.h"
+
+LineRingBuffer::LineRingBuffer()
+{
+    buf = nullptr;
+    size = 1;
+    head = tail = line_start = 0;
+    nl_head = nl_tail = 0;
+}
+
+LineRingBuffer::~LineRingBuffer()
+{
+    allocate(0);
+}
+
+bool LineRingBuffer::allocate(size_t n)
+{
+    if(buf != nullptr) {
+        if(AHB0.has(buf)) AHB0.dealloc(buf);
+        else if(AHB1.has(buf)) AHB1.dealloc(buf);
+        else delete [] buf;
+        buf = nullptr;
+    }
+    size = 1;
+    head = tail = line_start = 0;
+    nl_head = nl_tail = 0;
+    if(n == 0) return true;
+
+    // positions are kept in 16 bits
+    if(n > 65535) n = 65535;
+    // nothing DMAs into this and the planner queue is allocated from AHB0 later on, so leave that alone
+    buf = (char *)AHB1.alloc(n);
+    if(buf == nullptr) buf = new char[n];
+    if(buf == nullptr) return false;
+    size = n;
+    return true;
+}
+
+bool LineRingBuffer::put(char c)
+{
+    size_t h = next(head);
+    if(h == tail) return false;
+
+    bool nl = (c == '\n' || c == '\r');
+    if(nl && lines_free() == 0) return false;
+
+    buf[head] = c;
+    head = h;
+    if(nl) {
+        nl_pos[nl_head] = h;
+        nl_head = (nl_head + 1) & (nl_size - 1);
+        line_start = h;
+    }
+    return true;
+}
+
+void LineRingBuffer::unput()
+{
+    if(head != line_start) {
+        head = head == 0 ? size - 1 : head - 1;
+    }
+}
+
+void LineRingBuffer::drop_partial()
+{
+    head = line_start;
+}
+
+bool LineRingBuffer::get_line(std::string &line)
+{
+    if(nl_head == nl_tail) return false;
+
+    // end is just after the terminator
+    size_t end = nl_pos[nl_tail];
+    size_t last = end == 0 ? size - 1 : end - 1;
+    if(last >= tail) {
+        line.assign(&buf[tail], last - tail);
+    } else {
+        // wraps around the end of the buffer
+        line.assign(&buf[tail], size - tail);
+        line.append(buf, last);
+    }
+
+    tail = end;
+    nl_tail = (nl_tail + 1) & (nl_size - 1);
+    return true;
+}
+
+bool LineRingBuffer::get_char(char &c)
+{
+    if(head == tail) return false;
+
+    c = buf[tail];
+    tail = next(tail);
+    if(nl_head != nl_tail && tail == nl_pos[nl_tail]) {
+        nl_tail = (nl_tail + 1) & (nl_size - 1);
+    }
+    return true;
+}
+
+void LineRingBuffer::flush()
+{
+    tail = line_start = head;
+    nl_tail = nl_head;
+}
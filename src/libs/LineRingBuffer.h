@@ -0,0 +1,59 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+// Receive buffer for a console. Characters are put in from an interrupt and complete lines are taken out in
+// the main loop. Where each line ends is queued as it arrives, so finding a line does not mean searching the
+// buffer, and a line is copied out in at most two pieces rather than a character at a time.
+// One producer (the interrupt) and one consumer (the main loop), only flush() needs to be called with the
+// interrupt off if it is used from the main loop.
+class LineRingBuffer {
+    public:
+        LineRingBuffer();
+        ~LineRingBuffer();
+
+        // (re)allocates the buffer in AHB1 if there is room, else on the heap, anything in it is lost
+        bool allocate(size_t size);
+
+        // producer side
+        // adds c, a '\n' or '\r' ends the line. returns false if there is no room for it
+        bool put(char c);
+        // removes the last character of the line being received, for backspace
+        void unput();
+        // drops the line being received
+        void drop_partial();
+
+        // consumer side
+        // takes the next complete line without its terminator, returns false if there is none
+        bool get_line(std::string &line);
+        // takes a single character, as it was received
+        bool get_char(char &c);
+        void flush();
+
+        size_t lines() const { return (nl_head - nl_tail) & (nl_size - 1); }
+        size_t available() const { return (head - tail + size) % size; }
+        size_t free() const { return size - 1 - available(); }
+        size_t lines_free() const { return nl_size - 1 - lines(); }
+        size_t capacity() const { return size - 1; }
+
+        static const size_t nl_size = 128; // power of two
+
+    private:
+        size_t next(size_t i) const { return i + 1 == size ? 0 : i + 1; }
+
+        char *buf;
+        size_t size;
+        volatile size_t head, tail;
+        size_t line_start;              // where the line being received starts
+        uint16_t nl_pos[nl_size];       // where each complete line ends
+        volatile uint8_t nl_head, nl_tail;
+};
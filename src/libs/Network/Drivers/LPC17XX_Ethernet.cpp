@@ -2,6 +2,7 @@
 #include "LPC17XX_Ethernet.h"
 
 #include "Kernel.h"
+#include "platform_memory.h"
 
 #include <cstring>
 #include <cstdio>
@@ -157,9 +158,6 @@ int32_t emac_SetPHYMode(uint32_t ulPHYMode)
     return (0);
 }
 
-_rxbuf_t LPC17XX_Ethernet::rxbuf __attribute__ ((section ("AHBSRAM1"))) __attribute__((aligned(8)));
-_txbuf_t LPC17XX_Ethernet::txbuf __attribute__ ((section ("AHBSRAM1"))) __attribute__((aligned(8)));
-
 LPC17XX_Ethernet* LPC17XX_Ethernet::instance;
 
 LPC17XX_Ethernet::LPC17XX_Ethernet()
@@ -175,7 +173,41 @@ LPC17XX_Ethernet::LPC17XX_Ethernet()
     // ip_address = IPA(192,168,3,222);
     // ip_mask = 0xFFFFFF00;
 
-    for (int i = 0; i < LPC17XX_RXBUFS; i++) {
+    memset(&rxbuf, 0, sizeof(rxbuf));
+    memset(&txbuf, 0, sizeof(txbuf));
+
+    rx_frames = rx_bytes = rx_dropped = 0;
+    rx_rate = rx_peak_rate = last_rx_bytes = 0;
+
+    interface_name = (uint8_t*) malloc(5);
+    memcpy(interface_name, "eth0", 5);
+
+    instance = this;
+
+    up = false;
+}
+
+// allocates the descriptor rings in AHB1, AHB0 is left for the planner queue. must be called before the module is loaded
+bool LPC17XX_Ethernet::alloc_buffers(int rx, int tx)
+{
+    // the status arrays have to be 8 byte aligned, the pools only give 4
+    size_t size = rx * (LPC17XX_MAX_PACKET + sizeof(RX_Stat) + sizeof(packet_desc)) +
+                  tx * (LPC17XX_MAX_PACKET + sizeof(TX_Stat) + sizeof(packet_desc)) + 4;
+
+    uint8_t *p = (uint8_t *)AHB1.alloc(size);
+    if (p == NULL) return false;
+
+    p += ((uint32_t)p) & 4;
+    rxbuf.rxstat = (RX_Stat *)p;            p += rx * sizeof(RX_Stat);
+    rxbuf.rxdesc = (packet_desc *)p;        p += rx * sizeof(packet_desc);
+    txbuf.txstat = (TX_Stat *)p;            p += tx * sizeof(TX_Stat);
+    txbuf.txdesc = (packet_desc *)p;        p += tx * sizeof(packet_desc);
+    rxbuf.buf = (uint8_t (*)[LPC17XX_MAX_PACKET])p; p += rx * LPC17XX_MAX_PACKET;
+    txbuf.buf = (uint8_t (*)[LPC17XX_MAX_PACKET])p;
+    rxbuf.count = rx;
+    txbuf.count = tx;
+
+    for (int i = 0; i < rx; i++) {
         rxbuf.rxdesc[i].packet = rxbuf.buf[i];
         rxbuf.rxdesc[i].control = (LPC17XX_MAX_PACKET - 1) | EMAC_RCTRL_INT;
 
@@ -183,19 +215,14 @@ LPC17XX_Ethernet::LPC17XX_Ethernet()
         rxbuf.rxstat[i].HashCRC = 0;
     }
 
-    for (int i = 0; i < LPC17XX_TXBUFS; i++) {
+    for (int i = 0; i < tx; i++) {
         txbuf.txdesc[i].packet = txbuf.buf[i];
         txbuf.txdesc[i].control = (LPC17XX_MAX_PACKET - 1) | EMAC_TCTRL_PAD | EMAC_TCTRL_CRC | EMAC_TCTRL_LAST | EMAC_TCTRL_INT;
 
         txbuf.txstat[i].Info = 0;
     }
 
-    interface_name = (uint8_t*) malloc(5);
-    memcpy(interface_name, "eth0", 5);
-
-    instance = this;
-
-    up = false;
+    return true;
 }
 
 void LPC17XX_Ethernet::on_module_loaded()
@@ -220,6 +247,10 @@ void LPC17XX_Ethernet::on_idle(void*)
 
 void LPC17XX_Ethernet::on_second_tick(void *) {
     check_interface();
+
+    rx_rate = rx_bytes - last_rx_bytes;
+    last_rx_bytes = rx_bytes;
+    if (rx_rate > rx_peak_rate) rx_peak_rate = rx_rate;
 }
 
 void LPC17XX_Ethernet::check_interface()
@@ -350,11 +381,11 @@ void LPC17XX_Ethernet::emac_init()
     /* Initialize Tx and Rx DMA Descriptors */
     LPC_EMAC->RxDescriptor       = (uint32_t) rxbuf.rxdesc;
     LPC_EMAC->RxStatus           = (uint32_t) rxbuf.rxstat;
-    LPC_EMAC->RxDescriptorNumber = LPC17XX_RXBUFS-1;
+    LPC_EMAC->RxDescriptorNumber = rxbuf.count-1;
 
     LPC_EMAC->TxDescriptor       = (uint32_t) txbuf.txdesc;
     LPC_EMAC->TxStatus           = (uint32_t) txbuf.txstat;
-    LPC_EMAC->TxDescriptorNumber = LPC17XX_TXBUFS-1;
+    LPC_EMAC->TxDescriptorNumber = txbuf.count-1;
 
     // Set Receive Filter register: enable broadcast and multicast
     LPC_EMAC->RxFilterCtrl = EMAC_RFC_BCAST_EN | EMAC_RFC_PERFECT_EN;
@@ -377,31 +408,27 @@ void LPC17XX_Ethernet::set_mac(uint8_t* newmac)
     memcpy(mac_address, newmac, 6);
 }
 
-// size must be preloaded with max size of packet buffer
-bool LPC17XX_Ethernet::_receive_frame(void *packet, int *size)
+// the frame is left in its receive buffer so it can be worked on in place, the descriptor is not given back
+// to the EMAC until release_read_packet() is called
+bool LPC17XX_Ethernet::_receive_frame(uint8_t **packet, int *size)
 {
-    if (can_read_packet() && can_write_packet())
+    while (can_read_packet() && can_write_packet())
     {
         int i = LPC_EMAC->RxConsumeIndex;
         RX_Stat* stat = &(rxbuf.rxstat[i]);
         int len = (stat->Info & EMAC_RINFO_SIZE) + 1; //this is the index so add one to get the size
-        if(len <= *size) { // check against recieving buffer length
-            memcpy(packet, rxbuf.buf[i], len);
-            *size= len;
-        }else{
-            // discard frame that is too big for input buffer
-            DEBUG_PRINTF("WARNING: Discarded ethernet frame that is too big: %08lX, %d - %d\n", stat->Info, len, *size);
-            *size= 0;
+        if(stat->Info & EMAC_RINFO_LAST_FLAG) {
+            *packet = rxbuf.buf[i];
+            *size = len;
+            rx_frames++;
+            rx_bytes += len;
+            return true;
         }
 
-        //DEBUG_PRINTF("Received %d byte Ethernet frame %lu/%lu\n", *size, LPC_EMAC->RxProduceIndex, LPC_EMAC->RxConsumeIndex);
-
-        uint32_t r = LPC_EMAC->RxConsumeIndex + 1;
-        if (r > LPC_EMAC->RxDescriptorNumber)
-            r = 0;
-        LPC_EMAC->RxConsumeIndex = r;
-
-        return *size > 0;
+        // discard frame that is too big for one buffer
+        DEBUG_PRINTF("WARNING: Discarded ethernet frame that is too big: %08lX, %d\n", stat->Info, len);
+        rx_dropped++;
+        release_read_packet(rxbuf.buf[i]);
     }
 
     return false;
@@ -484,7 +511,7 @@ void LPC17XX_Ethernet::set_payload_length(NET_PACKET packet, int length)
 {
     uint32_t offset = ((uint8_t*) packet) - txbuf.buf[0];
     int i = (offset / LPC17XX_MAX_PACKET);
-    if ((i < LPC17XX_TXBUFS) && ((offset % LPC17XX_MAX_PACKET) == 0))
+    if ((i < txbuf.count) && ((offset % LPC17XX_MAX_PACKET) == 0))
     {
         txbuf.txdesc[i].control = (txbuf.txdesc[i].control & ~EMAC_TCTRL_SIZE) | (length & EMAC_TCTRL_SIZE);
     }
@@ -11,8 +11,10 @@
 // SMSC 8720A special control/status register
 #define EMAC_PHY_REG_SCSR 0x1F
 
-#define LPC17XX_MAX_PACKET 600
-#define LPC17XX_TXBUFS     4
+// a whole frame fits in one buffer, so uIP can work on it where the EMAC put it
+#define LPC17XX_MAX_PACKET EMAC_ETH_MAX_FLEN
+// default ring sizes, network.rx_buffers and network.tx_buffers change them
+#define LPC17XX_TXBUFS     3
 #define LPC17XX_RXBUFS     4
 
 typedef struct {
@@ -20,16 +22,19 @@ typedef struct {
     uint32_t control;
 } packet_desc;
 
+// the rings are allocated in AHB SRAM as the EMAC can only DMA to and from there
 typedef struct {
-    uint8_t buf[LPC17XX_RXBUFS][LPC17XX_MAX_PACKET];
-    RX_Stat rxstat[LPC17XX_RXBUFS];
-    packet_desc rxdesc[LPC17XX_RXBUFS];
+    uint8_t (*buf)[LPC17XX_MAX_PACKET];
+    RX_Stat* rxstat;
+    packet_desc* rxdesc;
+    int count;
 } _rxbuf_t;
 
 typedef struct {
-    uint8_t buf[LPC17XX_TXBUFS][LPC17XX_MAX_PACKET];
-    TX_Stat txstat[LPC17XX_TXBUFS];
-    packet_desc txdesc[LPC17XX_TXBUFS];
+    uint8_t (*buf)[LPC17XX_MAX_PACKET];
+    TX_Stat* txstat;
+    packet_desc* txdesc;
+    int count;
 } _txbuf_t;
 
 class LPC17XX_Ethernet;
@@ -46,10 +51,14 @@ public:
     void emac_init(void) __attribute__ ((optimize("O0")));
 
     void set_mac(uint8_t*);
+    bool alloc_buffers(int rx, int tx);
+    int get_rx_buffers() const { return rxbuf.count; }
+    int get_tx_buffers() const { return txbuf.count; }
 
     void irq(void);
 
-    bool _receive_frame(void *packet, int* size);
+    // gets the next good frame in place, it must be given back with release_read_packet
+    bool _receive_frame(uint8_t **packet, int* size);
 
     // NetworkInterface methods
 //     void provide_net(netcore* n);
@@ -72,11 +81,20 @@ public:
 
     static LPC17XX_Ethernet* instance;
 
+    // receive counters, rx_rate is the bytes received in the last second
+    uint32_t rx_frames;
+    uint32_t rx_bytes;
+    uint32_t rx_dropped;
+    uint32_t rx_rate;
+    uint32_t rx_peak_rate;
+
 private:
-    static _rxbuf_t rxbuf;
-    static _txbuf_t txbuf;
+    _rxbuf_t rxbuf;
+    _txbuf_t txbuf;
 
     void check_interface();
+
+    uint32_t last_rx_bytes;
 };
 
 #endif /* _LPC17XX_ETHERNET_H */
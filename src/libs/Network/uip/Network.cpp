@@ -17,12 +17,14 @@
 #include "NetworkPublicAccess.h"
 #include "checksumm.h"
 #include "ConfigValue.h"
+#include "platform_memory.h"
 
 #include "uip.h"
 #include "telnetd.h"
 #include "webserver.h"
 #include "dhcpc.h"
 #include "sftpd.h"
+#include "streamd.h"
 
 #ifndef NOPLAN9
 #include "plan9.h"
@@ -36,11 +38,15 @@
 #define network_webserver_checksum CHECKSUM("webserver")
 #define network_telnet_checksum CHECKSUM("telnet")
 #define network_plan9_checksum CHECKSUM("plan9")
+#define network_stream_checksum CHECKSUM("stream")
+#define network_port_checksum CHECKSUM("port")
 #define network_mac_override_checksum CHECKSUM("mac_override")
 #define network_ip_address_checksum CHECKSUM("ip_address")
 #define network_hostname_checksum CHECKSUM("hostname")
 #define network_ip_gateway_checksum CHECKSUM("ip_gateway")
 #define network_ip_mask_checksum CHECKSUM("ip_mask")
+#define network_rx_buffers_checksum CHECKSUM("rx_buffers")
+#define network_tx_buffers_checksum CHECKSUM("tx_buffers")
 
 extern "C" void uip_log(char *m)
 {
@@ -56,7 +62,9 @@ Network::Network()
     tickcnt= 0;
     sftpd= NULL;
     hostname = NULL;
+    scratch_buf = NULL;
     plan9_enabled= false;
+    stream_enabled= false;
     command_q= CommandQueue::getInstance();
 }
 
@@ -66,6 +74,10 @@ Network::~Network()
     if (hostname != NULL) {
         delete hostname;
     }
+    if (scratch_buf != NULL) {
+        if (AHB1.has(scratch_buf)) AHB1.dealloc(scratch_buf);
+        else delete [] scratch_buf;
+    }
     theNetwork= nullptr;
 }
 
@@ -132,6 +144,8 @@ void Network::on_module_loaded()
     webserver_enabled = THEKERNEL->config->value( network_checksum, network_webserver_checksum, network_enable_checksum )->by_default(false)->as_bool();
     telnet_enabled = THEKERNEL->config->value( network_checksum, network_telnet_checksum, network_enable_checksum )->by_default(false)->as_bool();
     plan9_enabled = THEKERNEL->config->value( network_checksum, network_plan9_checksum, network_enable_checksum )->by_default(false)->as_bool();
+    stream_enabled = THEKERNEL->config->value( network_checksum, network_stream_checksum, network_enable_checksum )->by_default(false)->as_bool();
+    stream_port = THEKERNEL->config->value( network_checksum, network_stream_checksum, network_port_checksum )->by_default(2000)->as_int();
     string mac = THEKERNEL->config->value( network_checksum, network_mac_override_checksum )->by_default("")->as_string();
     if (mac.size() == 17 ) { // parse mac address
         if (!parse_ip_str(mac, mac_address, 6, 16, ':')) {
@@ -188,6 +202,28 @@ void Network::on_module_loaded()
         }
     }
 
+    // the frame rings, each buffer holds a whole frame. The EMAC can only reach AHB SRAM which they have to share
+    int rx_buffers = THEKERNEL->config->value( network_checksum, network_rx_buffers_checksum )->by_default(LPC17XX_RXBUFS)->as_int();
+    int tx_buffers = THEKERNEL->config->value( network_checksum, network_tx_buffers_checksum )->by_default(LPC17XX_TXBUFS)->as_int();
+    if (rx_buffers < 2) rx_buffers = 2;
+    if (tx_buffers < 3) tx_buffers = 3; // a split segment needs two free ones
+    while (!ethernet->alloc_buffers(rx_buffers, tx_buffers)) {
+        if (rx_buffers <= 2) {
+            printf("Network not started, no AHB1 memory for the ethernet buffers\n");
+            return;
+        }
+        --rx_buffers;
+    }
+    printf("Ethernet buffers: %d rx, %d tx\n", rx_buffers, tx_buffers);
+
+    // let the sender have as many full segments in flight as there are spare receive buffers
+    uip_receive_window = (rx_buffers - 1) * UIP_TCP_MSS;
+
+    // uip_buf points here when there is no received frame to work on, for the periodic and arp output
+    scratch_buf = (uint8_t *)AHB1.alloc(UIP_BUFSIZE + 4);
+    if (scratch_buf == NULL) scratch_buf = new uint8_t[UIP_BUFSIZE + 4];
+    uip_buf = scratch_buf;
+
     THEKERNEL->add_module( ethernet );
     THEKERNEL->slow_ticker->attach( 100, this, &Network::tick );
 
@@ -210,15 +246,23 @@ void Network::on_get_public_data(void* argument) {
 
     }else if(pdr->second_element_is(get_ipconfig_checksum)) {
         // NOTE caller must free the returned string when done
-        char buf[200];
+        char buf[360];
         int n1= snprintf(buf,             sizeof(buf),         "IP Addr: %d.%d.%d.%d\n", ipaddr[0], ipaddr[1], ipaddr[2], ipaddr[3]);
         int n2= snprintf(&buf[n1],       sizeof(buf)-n1,       "IP GW: %d.%d.%d.%d\n", ipgw[0], ipgw[1], ipgw[2], ipgw[3]);
         int n3= snprintf(&buf[n1+n2],    sizeof(buf)-n1-n2,    "IP mask: %d.%d.%d.%d\n", ipmask[0], ipmask[1], ipmask[2], ipmask[3]);
         int n4= snprintf(&buf[n1+n2+n3], sizeof(buf)-n1-n2-n3, "MAC Address: %02X:%02X:%02X:%02X:%02X:%02X\n",
             mac_address[0], mac_address[1], mac_address[2], mac_address[3], mac_address[4], mac_address[5]);
-        char *str = (char *)malloc(n1+n2+n3+n4+1);
-        memcpy(str, buf, n1+n2+n3+n4);
-        str[n1+n2+n3+n4]= '\0';
+        int n5= snprintf(&buf[n1+n2+n3+n4], sizeof(buf)-n1-n2-n3-n4, "RX: %lu frames, %lu bytes, %lu dropped, %lu bytes/s, peak %lu bytes/s, buffers %d rx %d tx\n",
+            ethernet->rx_frames, ethernet->rx_bytes, ethernet->rx_dropped, ethernet->rx_rate, ethernet->rx_peak_rate,
+            ethernet->get_rx_buffers(), ethernet->get_tx_buffers());
+        struct httpd_upload_stats up;
+        httpd_get_upload_stats(&up);
+        int n6= snprintf(&buf[n1+n2+n3+n4+n5], sizeof(buf)-n1-n2-n3-n4-n5, "Last upload: %d bytes in %u ms, %lu bytes/s%s\n",
+            up.bytes, up.ms, up.ms > 0 ? (unsigned long)((uint64_t)up.bytes * 1000 / up.ms) : 0UL, up.ok ? "" : ", failed");
+        int n= n1+n2+n3+n4+n5+n6;
+        char *str = (char *)malloc(n+1);
+        memcpy(str, buf, n);
+        str[n]= '\0';
         pdr->set_data_ptr(str);
         pdr->set_taken();
     }
@@ -235,10 +279,18 @@ void Network::on_idle(void *argument)
 {
     if (!ethernet->isUp()) return;
 
-    int len= sizeof(uip_buf); // set maximum size
-    if (ethernet->_receive_frame(uip_buf, &len)) {
-        uip_len = len;
-        this->handlePacket();
+    uint8_t *frame;
+    int len;
+    if (ethernet->_receive_frame(&frame, &len)) {
+        // work on each waiting frame where the EMAC put it, any reply is built over it and copied out by tapdev_send
+        int n= ethernet->get_rx_buffers();
+        do {
+            uip_buf = frame;
+            uip_len = len;
+            this->handlePacket();
+            ethernet->release_read_packet(frame);
+        } while (--n > 0 && ethernet->_receive_frame(&frame, &len));
+        uip_buf = scratch_buf;
 
     } else {
 
@@ -290,6 +342,11 @@ void Network::on_idle(void *argument)
             uip_arp_timer();
         }
     }
+
+    if (stream_enabled && Streamd::instance != NULL) {
+        Streamd::instance->on_idle();
+        poll_stream();
+    }
 }
 
 void Network::setup_servers()
@@ -314,6 +371,12 @@ void Network::setup_servers()
     }
 #endif
 
+    if (stream_enabled) {
+        // Initialize the raw gcode streaming server
+        Streamd::init(stream_port);
+        printf("Stream server initialized on port %d\n", stream_port);
+    }
+
     // sftpd service, which is lazily created on reciept of first packet
     uip_listen(HTONS(115));
 }
@@ -395,6 +458,26 @@ void Network::on_main_loop(void *argument)
     // issue one comamnd per iteration of main loop like USB serial does
     command_q->pop();
 
+    if (stream_enabled && Streamd::instance != NULL) {
+        Streamd::instance->on_main_loop();
+    }
+
+}
+
+// for buffers the C side wants in AHB SRAM, the heap is used when there is no room
+extern "C" void *network_ahb_alloc(size_t size)
+{
+    void *p = AHB0.alloc(size);
+    if (p == NULL) p = AHB1.alloc(size);
+    if (p == NULL) p = malloc(size);
+    return p;
+}
+
+extern "C" void network_ahb_free(void *p)
+{
+    if (AHB0.has(p)) AHB0.dealloc(p);
+    else if (AHB1.has(p)) AHB1.dealloc(p);
+    else free(p);
 }
 
 extern "C" const char *get_query_string()
@@ -405,6 +488,11 @@ extern "C" const char *get_query_string()
 // select between webserver and telnetd server
 extern "C" void app_select_appcall(void)
 {
+    if (theNetwork->stream_enabled && uip_conn->lport == HTONS(theNetwork->stream_port)) {
+        Streamd::appcall();
+        return;
+    }
+
     switch (uip_conn->lport) {
         case HTONS(80):
             if (theNetwork->webserver_enabled) httpd_appcall();
@@ -462,6 +550,19 @@ void network_device_send()
 }
 #endif
 
+// sends the stream replies as soon as they are there rather than on the next periodic poll
+void Network::poll_stream()
+{
+    struct uip_conn *conn = Streamd::instance->poll_conn();
+    if (conn == NULL || !ethernet->can_write_packet()) return;
+
+    uip_poll_conn(conn);
+    if (uip_len > 0) {
+        uip_arp_out();
+        network_device_send();
+    }
+}
+
 void Network::handlePacket(void)
 {
     if (uip_len > 0) {  /* received packet */
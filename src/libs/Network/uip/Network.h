@@ -28,19 +28,23 @@ public:
         bool telnet_enabled:1;
         bool plan9_enabled:1;
         bool use_dhcp:1;
+        bool stream_enabled:1;
     };
+    uint16_t stream_port;
 
 private:
     void init();
     void setup_servers();
     uint32_t tick(uint32_t dummy);
     void handlePacket();
+    void poll_stream();
 
     CommandQueue *command_q;
     LPC17XX_Ethernet *ethernet;
 
     struct timer periodic_timer, arp_timer;
     char *hostname;
+    uint8_t *scratch_buf;
     volatile uint32_t tickcnt;
     uint8_t mac_address[6];
     uint8_t ipaddr[4];
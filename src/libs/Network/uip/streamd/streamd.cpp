@@ -0,0 +1,280 @@
+#include "streamd.h"
+
+#include "Kernel.h"
+#include "Conveyor.h"
+#include "SerialMessage.h"
+#include "StreamOutputPool.h"
+
+#include "uip.h"
+#include "platform_memory.h"
+
+#include <string.h>
+
+#define DEBUG_PRINTF(...)
+//#define DEBUG_PRINTF printf
+
+Streamd *Streamd::instance = NULL;
+
+Streamd::Streamd()
+{
+    // nothing does DMA to these and AHB0 is left for the planner queue
+    rxbuf = (char *)AHB1.alloc(rx_size);
+    if (rxbuf == NULL) rxbuf = new char[rx_size];
+    txbuf = (char *)AHB1.alloc(tx_size);
+    if (txbuf == NULL) txbuf = new char[tx_size];
+    conn = NULL;
+    rx_head = rx_tail = line_start = nl_count = 0;
+    tx_head = tx_tail = tx_sent = 0;
+    halt_flag = query_flag = cancel_flag = false;
+    discard = long_line = false;
+}
+
+// static
+void Streamd::init(uint16_t port)
+{
+    if (instance == NULL) instance = new Streamd();
+    uip_listen(HTONS(port));
+}
+
+void Streamd::connected()
+{
+    conn = uip_conn;
+    rx_head = rx_tail = line_start = nl_count = 0;
+    tx_head = tx_tail = tx_sent = 0;
+    std::string().swap(overflow);
+    discard = long_line = false;
+    THEKERNEL->streams->append_stream(this);
+    puts("Smoothie\r\nok\r\n");
+}
+
+void Streamd::closed()
+{
+    DEBUG_PRINTF("Streamd: closed\n");
+    THEKERNEL->streams->remove_stream(this);
+    conn = NULL;
+    rx_head = rx_tail = line_start = nl_count = 0;
+    tx_head = tx_tail = tx_sent = 0;
+    std::string().swap(overflow);
+}
+
+void Streamd::newdata()
+{
+    const char *p = (const char *)uip_appdata;
+    int len = uip_datalen();
+
+    for (int i = 0; i < len; i++) {
+        char c = p[i];
+
+        // the same real time characters the USB serial takes
+        if (c == 'X' - 'A' + 1) { // ^X
+            halt_flag = true;
+            continue;
+        }
+        if (c == '?') {
+            query_flag = true;
+            continue;
+        }
+        if (c == '!') {
+            cancel_flag = true;
+            continue;
+        }
+
+        if (c == '\r') c = '\n';
+        if (discard) {
+            if (c == '\n') discard = false;
+            continue;
+        }
+
+        if (rx_free() == 0 || (c != '\n' && ((rx_head - line_start) & (rx_size - 1)) >= max_line)) {
+            // drop the whole line rather than play part of it
+            rx_head = line_start;
+            discard = true;
+            long_line = true;
+            continue;
+        }
+
+        rxbuf[rx_head] = c;
+        rx_head = (rx_head + 1) & (rx_size - 1);
+        if (c == '\n') {
+            line_start = rx_head;
+            nl_count++;
+        }
+    }
+
+    // a stopped connection does not take any more data, so stop while the next segment still fits. the host
+    // sends segments up to the MSS we advertise, uip_mss() is only the size we send
+    if (rx_free() < UIP_TCP_MSS) {
+        DEBUG_PRINTF("Streamd: stopped %d\n", rx_free());
+        uip_stop();
+    }
+}
+
+void Streamd::senddata()
+{
+    // anything not acked is sent again as it was, uIP only has one segment outstanding
+    if (tx_sent == 0) {
+        int n = (tx_head - tx_tail) & (tx_size - 1);
+        tx_sent = n < uip_mss() ? n : uip_mss();
+    }
+    if (tx_sent == 0) return;
+
+    char *d = (char *)uip_appdata;
+    for (int i = 0; i < tx_sent; i++) {
+        d[i] = txbuf[(tx_tail + i) & (tx_size - 1)];
+    }
+    uip_send(d, tx_sent);
+}
+
+bool Streamd::next_line(std::string &line)
+{
+    if (nl_count == 0) return false;
+
+    line.clear();
+    while (true) {
+        char c = rxbuf[rx_tail];
+        rx_tail = (rx_tail + 1) & (rx_size - 1);
+        if (c == '\n') break;
+        line += c;
+    }
+    nl_count--;
+    return true;
+}
+
+void Streamd::on_main_loop()
+{
+    if (conn == NULL) return;
+
+    if (long_line) {
+        long_line = false;
+        puts("Error: Discarded long line\r\n");
+    }
+
+    // only as many lines as the planner takes without waiting, and only while the replies will fit. a reply that
+    // did not fit has to be sent first, the host may be waiting for its ok
+    struct SerialMessage message;
+    message.stream = this;
+    message.message.reserve(max_line);
+    int fed = 0;
+    while (!THECONVEYOR->is_queue_full() && overflow.empty() && tx_free() >= 64 && ++fed <= 16 && next_line(message.message)) {
+        if (message.message.empty()) continue;
+        THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+    }
+}
+
+void Streamd::on_idle()
+{
+    if (halt_flag) {
+        halt_flag = false;
+        THEKERNEL->call_event(ON_HALT, nullptr);
+        if (THEKERNEL->is_grbl_mode()) {
+            puts("ALARM: Abort during cycle\r\n");
+        } else {
+            puts("HALTED, M999 or $X to exit HALT state\r\n");
+        }
+        // flush what was received, hopefully the host has stopped sending
+        rx_tail = line_start = rx_head;
+        nl_count = 0;
+    }
+
+    // answered once what is already there has been sent, so a host asking too often does not grow the overflow
+    if (query_flag && overflow.empty()) {
+        query_flag = false;
+        puts(THEKERNEL->get_query_string(this).c_str());
+    }
+
+    if (cancel_flag) {
+        cancel_flag = false;
+        THEKERNEL->call_event(ON_CANCEL, nullptr);
+    }
+}
+
+// the connection if it has replies to send or has room again after being stopped,
+// so they do not wait for the periodic poll
+struct uip_conn *Streamd::poll_conn()
+{
+    if (conn == NULL) return NULL;
+    if (tx_sent == 0 && tx_head != tx_tail) return conn;
+    if (uip_stopped(conn) && rx_free() >= rx_size / 2) return conn;
+    return NULL;
+}
+
+int Streamd::puts(const char *str)
+{
+    int len = strlen(str);
+    if (conn == NULL) return len;
+    int i = 0;
+    if (overflow.empty()) {
+        for (; i < len && tx_free() > 0; i++) {
+            txbuf[tx_head] = str[i];
+            tx_head = (tx_head + 1) & (tx_size - 1);
+        }
+    }
+    if (i < len) overflow.append(str + i, len - i);
+    return len;
+}
+
+int Streamd::_putc(int c)
+{
+    if (conn == NULL) return 1;
+    if (overflow.empty() && tx_free() > 0) {
+        txbuf[tx_head] = c;
+        tx_head = (tx_head + 1) & (tx_size - 1);
+    } else {
+        overflow += (char)c;
+    }
+    return 1;
+}
+
+// moves what the ring has room for from the overflow, called when a segment was acked
+void Streamd::fill_tx()
+{
+    int n = 0;
+    int len = overflow.size();
+    for (; n < len && tx_free() > 0; n++) {
+        txbuf[tx_head] = overflow[n];
+        tx_head = (tx_head + 1) & (tx_size - 1);
+    }
+    if (n == len) std::string().swap(overflow);
+    else overflow.erase(0, n);
+}
+
+// static
+void Streamd::appcall(void)
+{
+    Streamd *s = instance;
+
+    if (uip_connected()) {
+        if (s->conn != NULL) {
+            // one host at a time
+            uip_abort();
+            return;
+        }
+        s->connected();
+    }
+
+    if (uip_conn != s->conn) return;
+
+    if (uip_closed() || uip_aborted() || uip_timedout()) {
+        s->closed();
+        return;
+    }
+
+    if (uip_acked()) {
+        s->tx_tail = (s->tx_tail + s->tx_sent) & (tx_size - 1);
+        s->tx_sent = 0;
+        if (!s->overflow.empty()) s->fill_tx();
+    }
+
+    if (uip_newdata()) {
+        s->newdata();
+    }
+
+    if (uip_poll() && uip_stopped(uip_conn) && s->rx_free() >= rx_size / 2) {
+        DEBUG_PRINTF("Streamd: restarted %d\n", s->rx_free());
+        uip_restart();
+    }
+
+    if (uip_rexmit() || uip_newdata() || uip_acked() || uip_connected() || uip_poll()) {
+        s->senddata();
+    }
+}
@@ -0,0 +1,69 @@
+#ifndef __STREAMD_H__
+#define __STREAMD_H__
+
+/*
+ * A raw TCP port for streaming gcode from a host, it is played the way lines from the USB serial are.
+ * Lines go into a ring buffer allocated once when the server starts and are fed to the dispatcher from the
+ * main loop while the planner queue has room. When the ring fills up the connection is stopped, which
+ * advertises a zero window, so the host is held back by how fast the planner takes the lines.
+ * Replies go into a transmit ring, what does not fit is held in an overflow string and no more lines are played
+ * until it has been sent, so a reply is never cut short.
+ */
+
+#include "StreamOutput.h"
+
+#include <stdint.h>
+#include <string>
+
+struct uip_conn;
+
+class Streamd : public StreamOutput
+{
+public:
+    static void init(uint16_t port);
+    static void appcall(void);
+    static Streamd *instance;
+
+    // called from the Network module
+    void on_main_loop();
+    void on_idle();
+    struct uip_conn *poll_conn();
+
+    int puts(const char *str);
+    int _putc(int c);
+    int rx_free() const { return rx_size - 1 - ((rx_head - rx_tail) & (rx_size - 1)); }
+
+private:
+    Streamd();
+
+    static const int rx_size = 4096;     // power of two
+    static const int tx_size = 1024;     // power of two
+    static const int max_line = 255;
+
+    int tx_free() const { return tx_size - 1 - ((tx_head - tx_tail) & (tx_size - 1)); }
+    bool next_line(std::string &line);
+    void fill_tx();
+    void connected();
+    void closed();
+    void newdata();
+    void senddata();
+
+    char *rxbuf;
+    char *txbuf;
+    std::string overflow;   // reply bytes that did not fit in txbuf yet
+    struct uip_conn *conn;
+    uint16_t rx_head, rx_tail;
+    uint16_t line_start;    // where the line being received starts in rxbuf
+    uint16_t tx_head, tx_tail;
+    uint16_t tx_sent;       // bytes from tx_tail that are sent and not yet acked
+    uint16_t nl_count;      // complete lines in rxbuf
+    struct {
+        bool halt_flag:1;
+        bool query_flag:1;
+        bool cancel_flag:1;
+        bool discard:1;
+        bool long_line:1;
+    };
+};
+
+#endif /* __STREAMD_H__ */
@@ -104,7 +104,28 @@ typedef unsigned short uip_stats_t;
  *
  * \hideinitializer
  */
-#define UIP_CONF_BUFFER_SIZE     400
+#define UIP_CONF_BUFFER_SIZE     1514
+
+/**
+ * uip_buf is a pointer the driver sets to the frame in its receive
+ * buffer, instead of a buffer frames are copied into.
+ *
+ * \hideinitializer
+ */
+#define UIP_CONF_BUFFER_POINTER  1
+
+/**
+ * The TCP receive window is a variable the driver sets to what its
+ * receive ring can hold, so that many segments can be in flight.
+ *
+ * \hideinitializer
+ */
+#ifdef __cplusplus
+extern "C" u16_t uip_receive_window;
+#else
+extern u16_t uip_receive_window;
+#endif
+#define UIP_CONF_RECEIVE_WINDOW  uip_receive_window
 
 #define UIP_CONF_BROADCAST 1
 
@@ -151,11 +151,19 @@ const struct uip_eth_addr uip_ethaddr = {{
 struct uip_eth_addr uip_ethaddr = {{0, 0, 0, 0, 0, 0}};
 #endif
 
-#ifndef UIP_CONF_EXTERNAL_BUFFER
+#if UIP_CONF_BUFFER_POINTER
+u8_t *uip_buf;                   /* Points at the packet being worked
+                    on, set by the driver. */
+#elif !defined(UIP_CONF_EXTERNAL_BUFFER)
 u8_t uip_buf[UIP_BUFSIZE + 4] __attribute__ ((section ("AHBSRAM1")));   /* The packet buffer that contains
                     incoming packets. */
 #endif /* UIP_CONF_EXTERNAL_BUFFER */
 
+#ifdef UIP_CONF_RECEIVE_WINDOW
+u16_t uip_receive_window = UIP_TCP_MSS; /* The advertised window,
+                    set by the driver. */
+#endif
+
 void *uip_appdata;               /* The uip_appdata pointer points to
                     application data. */
 void *uip_sappdata;              /* The uip_appdata pointer points to
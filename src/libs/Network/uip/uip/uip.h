@@ -427,11 +427,21 @@ void uip_setipid(u16_t id);
  \endcode
  */
 
+#if UIP_CONF_BUFFER_POINTER
+/* the driver points uip_buf at each frame where it was received, so it is worked on in place, and at a
+   spare buffer otherwise. Whatever it points to must have UIP_BUFSIZE+4 bytes that can be written */
+#ifdef __cplusplus
+extern "C" u8_t *uip_buf;
+#else
+extern u8_t *uip_buf;
+#endif
+#else
 #ifdef __cplusplus
 extern "C" u8_t uip_buf[UIP_BUFSIZE+4];
 #else
 extern u8_t uip_buf[UIP_BUFSIZE+4];
 #endif
+#endif /* UIP_CONF_BUFFER_POINTER */
 
 #ifdef __cplusplus
 extern "C" {
@@ -64,11 +64,13 @@
 #include <stdio.h>
 
 #include "uip.h"
+#include "clock.h"
 #include "httpd.h"
 #include "httpd-fs.h"
 #include "http-strings.h"
 
 #include <string.h>
+#include <unistd.h>
 #include "stdio.h"
 #include "stdlib.h"
 
@@ -99,6 +101,8 @@
 #define DEBUG_PRINTF(...)
 
 extern const char *get_query_string();
+extern void *network_ahb_alloc(size_t size);
+extern void network_ahb_free(void *p);
 
 // this callback gets the results of a command, line by line. need to check if
 // we need to stall the upstream sender return 0 if stalled 1 if ok to keep
@@ -141,43 +145,93 @@ static void create_callback_stream(struct httpd_state *s)
     s->pstream = new_callback_stream(command_result, s);
 }
 
-// Used to save files to SDCARD during upload
+// Used to save files to SDCARD during upload. The segments are gathered into whole sectors which are written
+// to the card in one go, fat then writes them straight to the card rather than through its sector buffer
+#define UPLOAD_BUFFER_SIZE 2048
 static FILE *fd;
 static char *output_filename = NULL;
+static uint8_t *upload_buf = NULL;
+static unsigned int upload_fill;
 static int file_cnt = 0;
-static int open_file(const char *fn)
+static clock_time_t upload_start;
+static void *upload_owner;
+static struct httpd_upload_stats last_upload;
+
+static int close_file(int complete);
+
+static int open_file(const char *fn, void *owner)
 {
-    if (output_filename != NULL) free(output_filename);
+    // an upload whose connection went away without being closed is still open, it is incomplete
+    if (upload_buf != NULL) close_file(0);
+
     output_filename = malloc(strlen(fn) + 5);
     strcpy(output_filename, "/sd/");
     strcat(output_filename, fn);
-    fd = fopen(output_filename, "w");
+    upload_buf = network_ahb_alloc(UPLOAD_BUFFER_SIZE);
+    fd = upload_buf == NULL ? NULL : fopen(output_filename, "w");
     if (fd == NULL) {
         free(output_filename);
         output_filename = NULL;
+        if (upload_buf != NULL) network_ahb_free(upload_buf);
+        upload_buf = NULL;
         return 0;
     }
+    upload_owner = owner;
+    upload_fill = 0;
+    file_cnt = 0;
+    upload_start = clock_time();
     return 1;
 }
 
-static int close_file()
+// writes the buffer through the descriptor, stdio would copy it through its own buffer a bit at a time
+static int flush_file()
+{
+    int ok = upload_fill == 0 || write(fileno(fd), upload_buf, upload_fill) == (int)upload_fill;
+    upload_fill = 0;
+    return ok;
+}
+
+// complete is set when the whole body was received, otherwise the partial file is deleted so it can not be played
+static int close_file(int complete)
 {
+    int ok = complete && flush_file();
+    fclose(fd);
+    fd = NULL;
+    if (!ok) remove(output_filename);
     free(output_filename);
     output_filename = NULL;
-    fclose(fd);
-    return 1;
+    network_ahb_free(upload_buf);
+    upload_buf = NULL;
+    upload_owner = NULL;
+
+    last_upload.bytes = file_cnt;
+    last_upload.ms = (clock_time() - upload_start) * (1000 / CLOCK_SECOND);
+    last_upload.ok = ok;
+    return ok;
 }
 
 static int save_file(uint8_t *buf, unsigned int len)
 {
-    if (fwrite(buf, 1, len, fd) == len) {
-        file_cnt += len;
-        return 1;
-
-    } else {
-        close_file();
-        return 0;
+    while (len > 0) {
+        unsigned int n = UPLOAD_BUFFER_SIZE - upload_fill;
+        if (n > len) n = len;
+        memcpy(&upload_buf[upload_fill], buf, n);
+        upload_fill += n;
+        buf += n;
+        len -= n;
+        file_cnt += n;
+
+        if (upload_fill == UPLOAD_BUFFER_SIZE && !flush_file()) {
+            close_file(0);
+            return 0;
+        }
     }
+    return 1;
+}
+
+void httpd_get_upload_stats(struct httpd_upload_stats *stats)
+{
+    *stats = last_upload;
 }
 
 static int fs_open(struct httpd_state *s)
@@ -426,7 +480,7 @@ static PT_THREAD(handle_uploaded_data(struct httpd_state *s, uint8_t *buf, int l
     DEBUG_PRINTF("Uploading file: %s, %d\n", s->upload_name, s->content_length);
 
     // The body is the raw data to be stored to the file
-    if (!open_file(s->upload_name)) {
+    if (!open_file(s->upload_name, s)) {
         DEBUG_PRINTF("failed to open file\n");
         s->uploadok = 0;
         PT_EXIT(&s->inputpt);
@@ -465,8 +519,7 @@ static PT_THREAD(handle_uploaded_data(struct httpd_state *s, uint8_t *buf, int l
         }
     }
 
-    close_file();
-    s->uploadok = 1;
+    s->uploadok = close_file(1);
     DEBUG_PRINTF("finished upload\n");
 
     PT_END(&s->inputpt);
@@ -663,7 +716,8 @@ httpd_appcall(void)
 
     if (uip_closed() || uip_aborted() || uip_timedout()) {
         DEBUG_PRINTF("Closing connection: %d\n", HTONS(uip_conn->rport));
-        if (s->fd != NULL) fclose(fd); // clean up
+        if (s->fd != NULL) fclose(s->fd); // clean up
+        if (upload_owner == s) close_file(0); // the upload was cut off
         if (s->strbuf != NULL) free(s->strbuf);
         if (s->pstream != NULL) {
             // free these if they were allocated
@@ -62,11 +62,19 @@ struct httpd_state {
   uint16_t command_count;
 };
 
+// the last file uploaded, ms is from opening the file to closing it
+struct httpd_upload_stats {
+  int bytes;
+  unsigned int ms;
+  uint8_t ok;
+};
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 void httpd_init(void);
+void httpd_get_upload_stats(struct httpd_upload_stats *stats);
 void httpd_appcall(void);
 
 void httpd_log(char *msg);
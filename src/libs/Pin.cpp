@@ -192,7 +192,7 @@ mbed::PwmOut* Pin::hardware_pwm()
     return nullptr;
 }
 
-mbed::InterruptIn* Pin::interrupt_pin()
+mbed::InterruptIn* Pin::interrupt_pin(bool keep_mode)
 {
     if(!this->valid) return nullptr;
 
@@ -201,7 +201,13 @@ mbed::InterruptIn* Pin::interrupt_pin()
 
     if (port_number == 0 || port_number == 2) {
         PinName pinname = port_pin((PortName)port_number, pin);
-        return new mbed::InterruptIn(pinname);
+        // two PINMODE registers per port, 16 pins each
+        volatile uint32_t *pinmode= &LPC_PINCON->PINMODE0 + port_number*2 + pin/16;
+        uint32_t mask= 3 << ((pin % 16) * 2);
+        uint32_t mode= *pinmode & mask;
+        mbed::InterruptIn *irq= new mbed::InterruptIn(pinname);
+        if(keep_mode) *pinmode= (*pinmode & ~mask) | mode;
+        return irq;
 
     }else{
         this->valid= false;
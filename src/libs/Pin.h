@@ -19,7 +19,7 @@ class Pin {
 
         Pin* from_string(std::string value);
 
-        inline bool connected(){
+        inline bool connected() const {
             return this->valid;
         }
 
@@ -65,7 +65,8 @@ class Pin {
 
         mbed::PwmOut *hardware_pwm();
 
-        mbed::InterruptIn *interrupt_pin();
+        // the mbed InterruptIn sets a pull down on the pin, keep_mode puts back the mode the pin was set to
+        mbed::InterruptIn *interrupt_pin(bool keep_mode= false);
 
         bool is_inverting() const { return inverting; }
         void set_inverting(bool f) { inverting= f; }
@@ -38,17 +38,26 @@ void Pwm::set(bool value)
 }
 
 uint32_t Pwm::on_tick(uint32_t dummy)
+{
+    int level = next_level();
+    if (level >= 0) {
+        Pin::set(level);
+    }
+    return dummy;
+}
+
+// Steps the modulator and returns the level the pin should have, or -1 if the pin was set directly with set()
+// and is not being modulated. PwmEngine writes the pin
+int Pwm::next_level()
 {
     if ((_pwm < 0) || _pwm >= PID_PWM_MAX) {
-        return dummy;
+        return -1;
     }
     else if (_pwm == 0) {
-        Pin::set(false);
-        return dummy;
+        return 0;
     }
     else if (_pwm == PID_PWM_MAX - 1) {
-        Pin::set(true);
-        return dummy;
+        return 1;
     }
 
     /*
@@ -129,7 +138,6 @@ uint32_t Pwm::on_tick(uint32_t dummy)
         if (_sd_accumulator <= 0)
             _sd_direction = false;
     }
-    Pin::set(_sd_direction);
 
-    return dummy;
+    return _sd_direction;
 }
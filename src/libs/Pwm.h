@@ -12,6 +12,7 @@ public:
 
     void     on_module_load(void);
     uint32_t on_tick(uint32_t);
+    int      next_level(void);
 
     Pwm*     max_pwm(int);
     int      max_pwm(void);
@@ -0,0 +1,112 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "PwmEngine.h"
+
+#include "libs/Kernel.h"
+#include "SlowTicker.h"
+#include "Pwm.h"
+#include "IsrProfile.h"
+
+#include <math.h>
+
+PwmEngine *PwmEngine::instance;
+
+ISR_PROFILE_DEFINE(pwm_tick_profile, "pwm_tick");
+
+PwmEngine::PwmEngine()
+{
+}
+
+PwmEngine *PwmEngine::getInstance()
+{
+    if(instance == nullptr) instance = new PwmEngine();
+    return instance;
+}
+
+bool PwmEngine::add(Pwm *pwm, uint32_t frequency)
+{
+    if(frequency == 0) frequency = 1;
+
+    output_t o;
+    o.pwm = pwm;
+    o.frequency = frequency;
+    o.bit = 0;
+    o.port = 0;
+    o.inverting = pwm->is_inverting();
+
+    // an output that is not connected is still stepped, its level is just not written anywhere
+    if(pwm->connected()) {
+        int p = port_index(pwm->port);
+        if(p < 0) return false;
+        o.port = p;
+        o.bit = 1 << pwm->pin;
+    }
+
+    // the tick reads the outputs, so they only change with it stopped
+    __disable_irq();
+    outputs.push_back(o);
+
+    if(hook == nullptr) {
+        this->frequency = frequency;
+        hook = THEKERNEL->slow_ticker->attach(frequency, this, &PwmEngine::tick);
+    } else if(frequency > this->frequency) {
+        this->frequency = frequency;
+        THEKERNEL->slow_ticker->set_hook_frequency(hook, frequency);
+    }
+
+    for(auto &out : outputs) {
+        uint32_t d = lroundf((float)this->frequency / out.frequency);
+        out.divider = d < 1 ? 1 : d > 0xFFFF ? 0xFFFF : d;
+        out.countdown = 1;
+    }
+    __enable_irq();
+    return true;
+}
+
+// the index in ports of gpio, added if it is the first output on it, -1 if there is no room for another port
+int PwmEngine::port_index(LPC_GPIO_TypeDef *gpio)
+{
+    for (uint8_t p = 0; p < num_ports; p++) {
+        if(ports[p].gpio == gpio) return p;
+    }
+    if(num_ports == ports.size()) return -1;
+
+    gpio_port_t& gp = ports[num_ports];
+    gp.gpio = gpio;
+    gp.set = gp.clr = 0;
+    return num_ports++;
+}
+
+uint32_t PwmEngine::tick(uint32_t dummy)
+{
+    ISR_PROFILE_SCOPE(pwm_tick_profile);
+
+    bool changed = false;
+    for(auto &o : outputs) {
+        if(--o.countdown != 0) continue;
+        o.countdown = o.divider;
+
+        int level = o.pwm->next_level();
+        if(level < 0 || o.bit == 0) continue; // set directly, not modulated, or not connected
+
+        if(level ^ o.inverting) ports[o.port].set |= o.bit;
+        else ports[o.port].clr |= o.bit;
+        changed = true;
+    }
+
+    if(changed) {
+        for (uint8_t p = 0; p < num_ports; p++) {
+            gpio_port_t& gp = ports[p];
+            if(gp.set) gp.gpio->FIOSET = gp.set;
+            if(gp.clr) gp.gpio->FIOCLR = gp.clr;
+            gp.set = gp.clr = 0;
+        }
+    }
+
+    return dummy;
+}
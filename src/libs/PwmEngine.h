@@ -0,0 +1,60 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <array>
+#include <vector>
+
+#include "libs/LPC17xx/sLPC17xx.h"
+
+class Pwm;
+class Hook;
+
+// Runs the sigma-delta modulators of all the Pwm outputs (heaters, switches, led strips) from one SlowTicker hook
+// instead of a hook each. The hook runs at the highest frequency asked for and the slower outputs every few ticks.
+// The levels of all the outputs due in a tick are gathered and written with one FIOSET and one FIOCLR per GPIO port.
+class PwmEngine {
+    public:
+        static PwmEngine *getInstance();
+
+        // frequency is how often the modulator of pwm is stepped, returns false if it could not be added
+        bool add(Pwm *pwm, uint32_t frequency);
+        uint32_t tick(uint32_t dummy);
+
+        uint32_t get_frequency() const { return frequency; }
+        size_t get_num_outputs() const { return outputs.size(); }
+
+    private:
+        PwmEngine();
+        int port_index(LPC_GPIO_TypeDef *gpio);
+
+        static PwmEngine *instance;
+
+        struct output_t {
+            Pwm *pwm;
+            uint32_t frequency;
+            uint32_t bit;
+            uint16_t divider;       // ticks between steps of its modulator
+            uint16_t countdown;
+            uint8_t port;
+            bool inverting;
+        };
+        std::vector<output_t> outputs;
+
+        struct gpio_port_t {
+            LPC_GPIO_TypeDef *gpio;
+            uint32_t set, clr;
+        };
+        std::array<gpio_port_t, 5> ports;
+        uint8_t num_ports{0};
+
+        Hook *hook{nullptr};
+        uint32_t frequency{0};
+};
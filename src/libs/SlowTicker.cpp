@@ -13,6 +13,7 @@
 #include "libs/Hook.h"
 #include "modules/robot/Conveyor.h"
 #include "Gcode.h"
+#include "IsrProfile.h"
 
 #include <mri.h>
 
@@ -21,6 +22,8 @@
 
 SlowTicker* global_slow_ticker;
 
+ISR_PROFILE_DEFINE(slow_tick_profile, "slow_tick");
+
 SlowTicker::SlowTicker(){
     global_slow_ticker = this;
 
@@ -56,6 +59,18 @@ void SlowTicker::set_frequency( int frequency ){
     flag_1s_count= SystemCoreClock>>2;
 }
 
+void SlowTicker::set_hook_frequency(Hook *hook, uint32_t frequency)
+{
+    __disable_irq();
+    hook->interval = floorf((SystemCoreClock/4)/frequency);
+    if(hook->countdown > hook->interval) hook->countdown = hook->interval;
+    if( frequency > this->max_frequency ){
+        this->max_frequency = frequency;
+        this->set_frequency(frequency);
+    }
+    __enable_irq();
+}
+
 // The actual interrupt being called by the timer, this is where work is done
 void SlowTicker::tick(){
 
@@ -123,6 +138,7 @@ void SlowTicker::on_idle(void*)
 }
 
 extern "C" void TIMER2_IRQHandler (void){
+    ISR_PROFILE_SCOPE(slow_tick_profile);
     if((LPC_TIM2->IR >> 0) & 1){  // If interrupt register set for MR0
         LPC_TIM2->IR |= 1 << 0;   // Reset it
     }
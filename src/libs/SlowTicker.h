@@ -45,6 +45,9 @@ class SlowTicker : public Module{
             return hook;
         }
 
+        // changes how often an attached hook is called
+        void set_hook_frequency(Hook *hook, uint32_t frequency);
+
     private:
         bool flag_1s();
 
@@ -12,9 +12,11 @@
 #include "libs/Module.h"
 #include "libs/Kernel.h"
 #include "StepperMotor.h"
+#include "Pin.h"
 #include "StreamOutputPool.h"
 #include "Block.h"
 #include "Conveyor.h"
+#include "IsrProfile.h"
 
 #include "system_LPC17xx.h" // mbed.h lib
 #include <math.h>
@@ -31,6 +33,10 @@ GPIO stepticker_debug_pin(STEPTICKER_DEBUG_PIN);
 
 StepTicker *StepTicker::instance;
 
+ISR_PROFILE_DEFINE(step_tick_profile, "step_tick");
+ISR_PROFILE_DEFINE(unstep_tick_profile, "unstep_tick");
+ISR_PROFILE_DEFINE(pendsv_profile, "pendsv");
+
 StepTicker::StepTicker()
 {
     instance = this; // setup the Singleton instance of the stepticker
@@ -49,7 +55,6 @@ StepTicker::StepTicker()
     this->set_frequency(100000);
     this->set_unstep_time(100);
 
-    this->unstep.reset();
     this->num_motors = 0;
 
     this->running = false;
@@ -96,16 +101,17 @@ void StepTicker::set_unstep_time( float microseconds )
 // Reset step pins on any motor that was stepped
 void StepTicker::unstep_tick()
 {
-    for (int i = 0; i < num_motors; i++) {
-        if(this->unstep[i]) {
-            this->motor[i]->unstep();
-        }
+    for (uint8_t p = 0; p < num_ports; p++) {
+        gpio_port_t& gp= ports[p];
+        if(gp.stepped_set) gp.gpio->FIOCLR= gp.stepped_set;
+        if(gp.stepped_clr) gp.gpio->FIOSET= gp.stepped_clr;
+        gp.stepped_set= gp.stepped_clr= 0;
     }
-    this->unstep.reset();
 }
 
 extern "C" void TIMER1_IRQHandler (void)
 {
+    ISR_PROFILE_SCOPE(unstep_tick_profile);
     LPC_TIM1->IR |= 1 << 0;
     StepTicker::getInstance()->unstep_tick();
 }
@@ -113,6 +119,7 @@ extern "C" void TIMER1_IRQHandler (void)
 // The actual interrupt handler where we do all the work
 extern "C" void TIMER0_IRQHandler (void)
 {
+    ISR_PROFILE_SCOPE(step_tick_profile);
     // Reset interrupt register
     LPC_TIM0->IR |= 1 << 0;
     StepTicker::getInstance()->step_tick();
@@ -120,6 +127,7 @@ extern "C" void TIMER0_IRQHandler (void)
 
 extern "C" void PendSV_Handler(void)
 {
+    ISR_PROFILE_SCOPE(pendsv_profile);
     StepTicker::getInstance()->handle_finish();
 }
 
@@ -154,56 +162,101 @@ void StepTicker::step_tick (void)
     }
 
     bool still_moving= false;
-    // foreach motor, if it is active see if time to issue a step to that motor
-    for (uint8_t m = 0; m < num_motors; m++) {
-        if(current_block->tick_info[m].steps_to_move == 0) continue; // not active
-
-        current_block->tick_info[m].steps_per_tick += current_block->tick_info[m].acceleration_change;
-
-        if(current_tick == current_block->tick_info[m].next_accel_event) {
-            if(current_tick == current_block->accelerate_until) { // We are done accelerating, deceleration becomes 0 : plateau
-                current_block->tick_info[m].acceleration_change = 0;
-                if(current_block->decelerate_after < current_block->total_move_ticks) {
-                    current_block->tick_info[m].next_accel_event = current_block->decelerate_after;
-                    if(current_tick != current_block->decelerate_after) { // We are plateauing
-                        // steps/sec / tick frequency to get steps per tick
-                        current_block->tick_info[m].steps_per_tick = current_block->tick_info[m].plateau_rate;
+    bool s_curve= current_block->is_s_curve;
+    // on the plateau every motor steps at a constant rate and there are no accel events to check
+    bool plateau= current_tick < current_block->decelerate_after &&
+                  (current_tick > current_block->accelerate_until || current_block->accelerate_until == 0);
+    uint8_t n_active= 0;
+    bool stepped= false;
+    // foreach motor that still has steps to issue in this block see if it is time to step it
+    for (uint8_t i = 0; i < num_active; i++) {
+        uint8_t m= active_motors[i];
+        Block::tickinfo_t& ti= current_block->tick_info[m];
+
+        if(!plateau) {
+            ti.steps_per_tick += ti.acceleration_change;
+            if(s_curve) {
+                // the s-curve ramps are cubic in time, so step the acceleration along them too
+                Block::s_curve_info_t& sc= current_block->s_curve_info[m];
+                ti.acceleration_change += sc.jerk;
+                sc.jerk += sc.snap;
+            }
+
+            if(current_tick == ti.next_accel_event) {
+                if(current_tick == current_block->accelerate_until) { // We are done accelerating, deceleration becomes 0 : plateau
+                    ti.acceleration_change = 0;
+                    if(s_curve) {
+                        current_block->s_curve_info[m].jerk = 0;
+                        current_block->s_curve_info[m].snap = 0;
+                    }
+                    if(current_block->decelerate_after < current_block->total_move_ticks) {
+                        ti.next_accel_event = current_block->decelerate_after;
+                        if(current_tick != current_block->decelerate_after) { // We are plateauing
+                            // steps/sec / tick frequency to get steps per tick
+                            ti.steps_per_tick = ti.plateau_rate;
+                        }
                     }
                 }
-            }
 
-            if(current_tick == current_block->decelerate_after) { // We start decelerating
-                current_block->tick_info[m].acceleration_change = current_block->tick_info[m].deceleration_change;
+                if(current_tick == current_block->decelerate_after) { // We start decelerating
+                    ti.acceleration_change = ti.deceleration_change;
+                    if(s_curve) {
+                        // the jerk at the start of the ramp follows from its snap and length, see Block::prepare()
+                        int64_t decel_ticks = current_block->total_move_ticks - current_block->decelerate_after;
+                        Block::s_curve_info_t& sc= current_block->s_curve_info[m];
+                        sc.jerk = -(sc.decel_snap * (decel_ticks - 2)) / 2;
+                        sc.snap = sc.decel_snap;
+                    }
+                }
             }
-        }
 
-        // protect against rounding errors and such
-        if(current_block->tick_info[m].steps_per_tick <= 0) {
-            current_block->tick_info[m].counter = STEPTICKER_FPSCALE; // we force completion this step by setting to 1.0
-            current_block->tick_info[m].steps_per_tick = 0;
+            // protect against rounding errors and such
+            if(ti.steps_per_tick <= 0) {
+                ti.counter = STEPTICKER_FPSCALE; // we force completion this step by setting to 1.0
+                ti.steps_per_tick = 0;
+            }
         }
 
-        current_block->tick_info[m].counter += current_block->tick_info[m].steps_per_tick;
+        ti.counter += ti.steps_per_tick;
 
-        if(current_block->tick_info[m].counter >= STEPTICKER_FPSCALE) { // >= 1.0 step time
-            current_block->tick_info[m].counter -= STEPTICKER_FPSCALE; // -= 1.0F;
-            ++current_block->tick_info[m].step_count;
+        if(ti.counter >= STEPTICKER_FPSCALE) { // >= 1.0 step time
+            ti.counter -= STEPTICKER_FPSCALE; // -= 1.0F;
+            ++ti.step_count;
 
-            // step the motor
-            bool ismoving= motor[m]->step(); // returns false if the moving flag was set to false externally (probes, endstops etc)
-            // we stepped so schedule an unstep
-            unstep.set(m);
+            // step the motor, its pin is set with the others below
+            bool ismoving= motor[m]->count_step(); // returns false if the moving flag was set to false externally (probes, endstops etc)
+            const motor_pins_t& mp= motor_pins[m];
+            ports[mp.step_port].set |= mp.step_set;
+            ports[mp.step_port].clr |= mp.step_clr;
+            stepped= true;
 
-            if(!ismoving || current_block->tick_info[m].step_count == current_block->tick_info[m].steps_to_move) {
+            if(!ismoving || ti.step_count == ti.steps_to_move) {
                 // done
-                current_block->tick_info[m].steps_to_move = 0;
+                ti.steps_to_move = 0;
                 motor[m]->stop_moving(); // let motor know it is no longer moving
             }
         }
 
+        // keep it in the list until it has issued all its steps
+        if(ti.steps_to_move != 0) active_motors[n_active++]= m;
+
         // see if any motors are still moving after this tick
         if(motor[m]->is_moving()) still_moving= true;
     }
+    num_active= n_active;
+
+    // the pulses of all the motors stepping in this tick start together
+    if(stepped) {
+        for (uint8_t p = 0; p < num_ports; p++) {
+            gpio_port_t& gp= ports[p];
+            if(gp.set) gp.gpio->FIOSET= gp.set;
+            if(gp.clr) gp.gpio->FIOCLR= gp.clr;
+            // recorded after the write, as unstep_tick() can interrupt this
+            gp.stepped_set |= gp.set;
+            gp.stepped_clr |= gp.clr;
+            gp.set= gp.clr= 0;
+        }
+    }
 
     // do this after so we start at tick 0
     current_tick++; // count number of ticks
@@ -212,7 +265,7 @@ void StepTicker::step_tick (void)
     // Note there could be a race here if we run another tick before the unsteps have happened,
     // right now it takes about 3-4us but if the unstep were near 10uS or greater it would be an issue
     // also it takes at least 2us to get here so even when set to 1us pulse width it will still be about 3us
-    if( unstep.any()) {
+    if(stepped) {
         LPC_TIM1->TCR = 3;
         LPC_TIM1->TCR = 1;
     }
@@ -249,22 +302,33 @@ bool StepTicker::start_next_block()
 {
     if(current_block == nullptr) return false;
 
-    bool ok= false;
-    // need to prepare each active motor
+    // need to prepare each active motor, and list them so step_tick() only looks at those
+    num_active= 0;
     for (uint8_t m = 0; m < num_motors; m++) {
         if(current_block->tick_info[m].steps_to_move == 0) continue;
 
-        ok= true; // mark at least one motor is moving
+        active_motors[num_active++]= m;
         // set direction bit here
         // NOTE this would be at least 10us before first step pulse.
         // TODO does this need to be done sooner, if so how without delaying next tick
-        motor[m]->set_direction(current_block->direction_bits[m]);
+        bool dir= current_block->direction_bits[m];
+        const motor_pins_t& mp= motor_pins[m];
+        if(dir ^ mp.dir_inverting) ports[mp.dir_port].set |= mp.dir_bit;
+        else ports[mp.dir_port].clr |= mp.dir_bit;
+        motor[m]->count_direction(dir);
         motor[m]->start_moving(); // also let motor know it is moving now
     }
 
+    for (uint8_t p = 0; p < num_ports; p++) {
+        gpio_port_t& gp= ports[p];
+        if(gp.set) gp.gpio->FIOSET= gp.set;
+        if(gp.clr) gp.gpio->FIOCLR= gp.clr;
+        gp.set= gp.clr= 0;
+    }
+
     current_tick= 0;
 
-    if(ok) {
+    if(num_active > 0) {
         //SET_STEPTICKER_DEBUG_PIN(1);
         return true;
 
@@ -278,9 +342,37 @@ bool StepTicker::start_next_block()
 }
 
 
-// returns index of the stepper motor in the array and bitset
+// returns index of the stepper motor in the array
 int StepTicker::register_motor(StepperMotor* m)
 {
+    motor_pins_t& mp= motor_pins[num_motors];
+    const Pin& step= m->get_step_pin();
+    const Pin& dir= m->get_dir_pin();
+
+    // a pin that is not connected gets no bits, so it is never written
+    uint32_t bit= step.connected() ? 1 << step.pin : 0;
+    mp.step_port= port_index(step);
+    mp.step_set= step.is_inverting() ? 0 : bit;
+    mp.step_clr= step.is_inverting() ? bit : 0;
+
+    mp.dir_port= port_index(dir);
+    mp.dir_bit= dir.connected() ? 1 << dir.pin : 0;
+    mp.dir_inverting= dir.is_inverting();
+
     motor[num_motors++] = m;
     return num_motors - 1;
 }
+
+// the index in ports of the GPIO port of pin, added if it is the first pin on it
+uint8_t StepTicker::port_index(const Pin& pin)
+{
+    for (uint8_t p = 0; p < num_ports; p++) {
+        if(ports[p].gpio == pin.port) return p;
+    }
+
+    gpio_port_t& gp= ports[num_ports];
+    gp.gpio= pin.port;
+    gp.set= gp.clr= 0;
+    gp.stepped_set= gp.stepped_clr= 0;
+    return num_ports++;
+}
@@ -17,9 +17,11 @@
 
 #include "ActuatorCoordinates.h"
 #include "TSRingBuffer.h"
+#include "libs/LPC17xx/sLPC17xx.h"
 
 class StepperMotor;
 class Block;
+class Pin;
 
 // handle 2.62 Fixed point
 #define STEPTICKER_FPSCALE (1LL<<62)
@@ -49,11 +51,33 @@ class StepTicker{
         static StepTicker *instance;
 
         bool start_next_block();
+        uint8_t port_index(const Pin& pin);
+
+        // the step and direction pins of the motors grouped by GPIO port, so the pins a tick changes are
+        // written with one FIOSET and one FIOCLR per port
+        struct gpio_port_t {
+            LPC_GPIO_TypeDef *gpio;
+            uint32_t set, clr;                  // gathered while a tick runs
+            volatile uint32_t stepped_set;      // step pins to put back in unstep_tick()
+            volatile uint32_t stepped_clr;      // the same for inverted step pins
+        };
+        std::array<gpio_port_t, 5> ports;
+        uint8_t num_ports{0};
+
+        // per motor, its port and the bit to set or clear for a step, or for a direction of 1
+        struct motor_pins_t {
+            uint32_t step_set, step_clr;
+            uint32_t dir_bit;
+            uint8_t step_port, dir_port;
+            bool dir_inverting;
+        };
+        std::array<motor_pins_t, k_max_actuators> motor_pins;
 
         float frequency;
         uint32_t period;
         std::array<StepperMotor*, k_max_actuators> motor;
-        std::bitset<k_max_actuators> unstep;
+        std::array<uint8_t, k_max_actuators> active_motors; // the motors with steps to issue in the current block
+        uint8_t num_active{0};
 
         Block *current_block;
         uint32_t current_tick{0};
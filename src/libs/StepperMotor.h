@@ -25,6 +25,12 @@ class StepperMotor  : public Module {
         // called from step ticker ISR
         inline void set_direction(bool f) { dir_pin.set(f); direction= f; }
 
+        // the step ticker writes the step and direction pins of all its motors itself, these only keep count
+        inline bool count_step() { current_position_steps += (direction?-1:1); return moving; }
+        inline void count_direction(bool f) { direction= f; }
+        const Pin& get_step_pin() const { return step_pin; }
+        const Pin& get_dir_pin() const { return dir_pin; }
+
         void enable(bool state) { en_pin.set(!state); };
         bool is_enabled() const { return !en_pin.get(); };
         bool is_moving() const { return moving; };
@@ -28,6 +28,8 @@ class StreamOutput {
         virtual int _getc(void) { return 0; }
         virtual int puts(const char* str) = 0;
         virtual bool ready() { return true; };
+        // free bytes in the receive buffer, for hosts that count what they have in flight, -1 if not known
+        virtual int rx_free() const { return -1; }
 
         static NullStreamOutput NullStream;
 };
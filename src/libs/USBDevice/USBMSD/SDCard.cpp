@@ -64,10 +64,11 @@
  * just always use the Standard Capacity cards with a block size of 512 bytes.
  * This is set with CMD16.
  *
- * You can read and write single blocks (CMD17, CMD25) or multiple blocks
- * (CMD18, CMD25). For simplicity, I'll just use single block accesses. When
- * the card gets a read command, it responds with a response token, and then
- * a data token or an error.
+ * You can read and write single blocks (CMD17, CMD24) or multiple blocks
+ * (CMD18, CMD25). Multiple block transfers are used when FatFs asks for
+ * more than one sector, saving a command and the card's access time per
+ * block. When the card gets a read command, it responds with a response
+ * token, and then a data token or an error.
  *
  * SPI Command Format
  * ------------------
@@ -115,23 +116,75 @@
  * +------+---------+---------+- -  - -+---------+-----------+----------+
  * | 0xFE | data[0] | data[1] |        | data[n] | crc[15:8] | crc[7:0] |
  * +------+---------+---------+- -  - -+---------+-----------+----------+
+ *
+ * Multiple Block Read and Write
+ * -----------------------------
+ *
+ * After CMD18 the card sends data blocks one after the other until it
+ * gets CMD12. After CMD25 each block starts with 0xFC instead of 0xFE, is
+ * acknowledged and waited for like a single block, and a 0xFD stop token
+ * ends the transfer.
+ *
+ * The data blocks go through the SSP FIFO directly, or by GPDMA when the
+ * buffer is in AHB SRAM, which is the only RAM the GPDMA can reach.
  */
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <algorithm>
 
 #include "SDCard.h"
+#include "us_ticker_api.h"
+#include "lpc17xx_gpdma.h"
 
 static const uint8_t OXFF = 0xFF;
 
 #define SD_COMMAND_TIMEOUT 5000
+// the spec allows 100ms for a read and 250ms for a write, SDHC cards up to 500ms
+#define SD_READ_TIMEOUT_US  100000
+#define SD_WRITE_TIMEOUT_US 500000
+
+#define SSP_SR_TNF (1 << 1)
+#define SSP_SR_RNE (1 << 2)
+#define SSP_DMACR_RXDMAE (1 << 0)
+#define SSP_DMACR_TXDMAE (1 << 1)
+
+// receive on the higher priority channel so the RX FIFO never overflows
+#define SD_DMA_RX_CHANNEL 0
+#define SD_DMA_TX_CHANNEL 1
+#define SD_DMA_RX LPC_GPDMACH0
+#define SD_DMA_TX LPC_GPDMACH1
+
+static bool dma_initialised = false;
 
-SDCard::SDCard(PinName mosi, PinName miso, PinName sclk, PinName cs) :
+SDCard::SDCard(PinName mosi, PinName miso, PinName sclk, PinName cs, int max_frequency) :
   _spi(mosi, miso, sclk), _cs(cs) {
     _cs.output();
     _cs = 1;
     busyflag = false;
     _sectors = 0;
+    _tran_speed = 0;
+    _max_frequency = max_frequency;
+
+    switch (sclk) {
+        case P0_7:
+        case P1_31:
+            _ssp = LPC_SSP1;
+            break;
+        case P0_15:
+        case P1_20:
+            _ssp = LPC_SSP0;
+            break;
+        default:
+            _ssp = NULL;
+    }
+}
+
+// the GPDMA can only reach the AHB SRAM banks and the peripherals
+static bool dma_capable(const void *p, int length)
+{
+    uint32_t a = (uint32_t)p;
+    return a >= 0x2007C000 && a + length <= 0x20084000;
 }
 
 #define R1_IDLE_STATE           (1 << 0)
@@ -277,7 +330,14 @@ int SDCard::disk_initialize()
         return 1;
     }
 
-    _spi.frequency(2500000); // Set to 2.5MHz for data transfer
+    // data transfers run as fast as the card and this interface allow, the card usually says 25MHz
+    int hz = (_tran_speed > 0) ? std::min(_tran_speed, _max_frequency) : 2500000;
+    _spi.frequency(hz);
+
+    if (_ssp != NULL && !dma_initialised) {
+        GPDMA_Init();
+        dma_initialised = true;
+    }
 
     busyflag = false;
 
@@ -285,47 +345,93 @@ int SDCard::disk_initialize()
 }
 
 int SDCard::disk_write(const char *buffer, uint32_t block_number)
+{
+    return disk_write_blocks(buffer, block_number, 1);
+}
+
+int SDCard::disk_read(char *buffer, uint32_t block_number)
+{
+    return disk_read_blocks(buffer, block_number, 1);
+}
+
+int SDCard::disk_write_blocks(const char *buffer, uint32_t block_number, uint32_t count)
 {
     if (busyflag)
         return 0;
 
-    busyflag = true;
-
     if (cardtype == SDCARD_FAIL)
         return -1;
-    // set write address for single block (CMD24)
-    if(_cmd(SDCMD_WRITE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
-        return 1;
+
+    busyflag = true;
+
+    int r = 0;
+    if (count == 1) {
+        // set write address for single block (CMD24)
+        if(_cmdx(SDCMD_WRITE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
+            r = 1;
+        } else {
+            r = _write_data(buffer, 512, 0xFE);
+        }
+    } else {
+        // set write address for multiple blocks (CMD25), they follow each other until the stop token
+        if(_cmdx(SDCMD_WRITE_MULTIPLE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
+            r = 1;
+        } else {
+            for (uint32_t i = 0; i < count && r == 0; i++, buffer += 512) {
+                r = _write_data(buffer, 512, 0xFC);
+            }
+            _spi.write(0xFD);
+            _spi.write(0xFF);
+            if (!_wait_ready(SD_WRITE_TIMEOUT_US))
+                r = 1;
+        }
     }
 
-    // send the data block
-    _write(buffer, 512);
+    _cs = 1;
+    _spi.write(0xFF);
 
     busyflag = false;
 
-    return 0;
+    return r;
 }
 
-int SDCard::disk_read(char *buffer, uint32_t block_number)
+int SDCard::disk_read_blocks(char *buffer, uint32_t block_number, uint32_t count)
 {
     if (busyflag)
         return 0;
 
-    busyflag = true;
-
     if (cardtype == SDCARD_FAIL)
         return -1;
-    // set read address for single block (CMD17)
-    if(_cmd(SDCMD_READ_SINGLE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
-        return 1;
+
+    busyflag = true;
+
+    int r = 0;
+    if (count == 1) {
+        // set read address for single block (CMD17)
+        if(_cmdx(SDCMD_READ_SINGLE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
+            r = 1;
+        } else {
+            r = _read_data(buffer, 512);
+        }
+    } else {
+        // set read address for multiple blocks (CMD18), the card sends them until CMD12
+        if(_cmdx(SDCMD_READ_MULTIPLE_BLOCK, BLOCK2ADDR(block_number)) != 0) {
+            r = 1;
+        } else {
+            for (uint32_t i = 0; i < count && r == 0; i++, buffer += 512) {
+                r = _read_data(buffer, 512);
+            }
+            if (_stop_transmission() != 0)
+                r = 1;
+        }
     }
 
-    // receive the data
-    _read(buffer, 512);
+    _cs = 1;
+    _spi.write(0xFF);
 
     busyflag = false;
 
-    return 0;
+    return r;
 }
 
 int SDCard::disk_status() { return (_sectors > 0)?0:1; }
@@ -336,7 +442,7 @@ int SDCard::disk_sync() {
 uint32_t SDCard::disk_sectors() { return _sectors; }
 uint64_t SDCard::disk_size() { return ((uint64_t) _sectors) << 9; }
 uint32_t SDCard::disk_blocksize() { return (1<<9); }
-bool SDCard::disk_canDMA() { return false; }
+bool SDCard::disk_canDMA() { return _ssp != NULL; }
 
 SDCard::CARD_TYPE SDCard::card_type()
 {
@@ -453,42 +559,86 @@ int SDCard::_cmd8() {
     return -1; // timeout
 }
 
-int SDCard::_read(char *buffer, int length) {
-    _cs = 0;
+// CMD12 ends a multiple block read, a stuff byte comes before the R1 and the card may then be busy
+int SDCard::_stop_transmission() {
+    _spi.write(0x40 | SDCMD_STOP_TRANSMISSION);
+    _spi.write(0x00);
+    _spi.write(0x00);
+    _spi.write(0x00);
+    _spi.write(0x00);
+    _spi.write(0x95);
+    _spi.write(0xFF);
 
-    // read until start byte (0xFF)
-    while(_spi.write(0xFF) != 0xFE);
-//     uint8_t r;
-//     while((r = _spi.write(0xFF)) != 0xFE)
-//     {
-//         iprintf("0x%02X ", r);
-//         for (volatile uint32_t j = 262144; j; j--);
-//     }
-//
-//     iprintf("Got start byte, reading data\n");
+    int response = -1;
+    for(int i=0; i<SD_COMMAND_TIMEOUT; i++) {
+        int r = _spi.write(0xFF);
+        if(!(r & 0x80)) {
+            response = r;
+            break;
+        }
+    }
+    if (!_wait_ready(SD_READ_TIMEOUT_US))
+        return -1;
+    return response;
+}
 
-    // read data
-    for(int i=0; i<length; i++) {
-        buffer[i] = _spi.write(0xFF);
+// the card holds MISO low while it is busy
+bool SDCard::_wait_ready(uint32_t timeout_us) {
+    uint32_t start = us_ticker_read();
+    while(_spi.write(0xFF) != 0xFF) {
+        if (us_ticker_read() - start > timeout_us)
+            return false;
     }
-    _spi.write(0xFF); // checksum
-    _spi.write(0xFF);
+    return true;
+}
+
+int SDCard::_read(char *buffer, int length) {
+    _cs = 0;
+
+    int r = _read_data(buffer, length);
 
     _cs = 1;
     _spi.write(0xFF);
-    return 0;
+    return r;
 }
 
 int SDCard::_write(const char *buffer, int length) {
     _cs = 0;
 
+    int r = _write_data(buffer, length, 0xFE);
+
+    _cs = 1;
+    _spi.write(0xFF);
+    return r;
+}
+
+// read one data block with the card already selected
+int SDCard::_read_data(char *buffer, int length) {
+    // wait for the start byte (0xFE), the card sends 0xFF until the data is ready
+    uint32_t start = us_ticker_read();
+    int token;
+    while((token = _spi.write(0xFF)) == 0xFF) {
+        if (us_ticker_read() - start > SD_READ_TIMEOUT_US)
+            return 1;
+    }
+    if (token != 0xFE)
+        return 1; // error token
+
+    // read data
+    _transfer(buffer, NULL, length);
+
+    _spi.write(0xFF); // checksum
+    _spi.write(0xFF);
+    return 0;
+}
+
+// write one data block with the card already selected, token is 0xFE for a single block and 0xFC within a multiple block write
+int SDCard::_write_data(const char *buffer, int length, int token) {
     // indicate start of block
-    _spi.write(0xFE);
+    _spi.write(token);
 
     // write the data
-    for(int i=0; i<length; i++) {
-        _spi.write(buffer[i]);
-    }
+    _transfer(NULL, buffer, length);
 
     // write the checksum
     _spi.write(0xFF);
@@ -496,17 +646,89 @@ int SDCard::_write(const char *buffer, int length) {
 
     // check the repsonse token
     if((_spi.write(0xFF) & 0x1F) != 0x05) {
-        _cs = 1;
-        _spi.write(0xFF);
         return 1;
     }
 
     // wait for write to finish
-    while(_spi.write(0xFF) == 0);
+    return _wait_ready(SD_WRITE_TIMEOUT_US) ? 0 : 1;
+}
 
-    _cs = 1;
-    _spi.write(0xFF);
-    return 0;
+// clock length bytes through the SSP, sending tx or 0xFF if it is NULL and keeping what comes back in rx unless it is NULL
+void SDCard::_transfer(char *rx, const char *tx, int length) {
+    if (_ssp == NULL) {
+        for(int i=0; i<length; i++) {
+            int r = _spi.write(tx != NULL ? tx[i] : 0xFF);
+            if (rx != NULL)
+                rx[i] = r;
+        }
+        return;
+    }
+
+    if (_transfer_dma(rx, tx, length))
+        return;
+
+    // keep the FIFO full, it is 8 frames deep so no more than that can be in flight or the RX side overruns
+    int sent = 0, received = 0;
+    while (received < length) {
+        while (sent < length && sent - received < 8 && (_ssp->SR & SSP_SR_TNF)) {
+            _ssp->DR = (tx != NULL) ? tx[sent] : 0xFF;
+            sent++;
+        }
+        while (received < sent && (_ssp->SR & SSP_SR_RNE)) {
+            uint8_t r = _ssp->DR;
+            if (rx != NULL)
+                rx[received] = r;
+            received++;
+        }
+    }
+}
+
+// returns false without doing anything if the buffers are where the GPDMA cannot reach them
+bool SDCard::_transfer_dma(char *rx, const char *tx, int length) {
+    if (!dma_initialised || !dma_capable(&_dma_fill, 1) || !dma_capable(&_dma_sink, 1))
+        return false;
+    if ((rx != NULL && !dma_capable(rx, length)) || (tx != NULL && !dma_capable(tx, length)))
+        return false;
+
+    GPDMA_Channel_CFG_Type cfg;
+    cfg.TransferSize = length;
+    cfg.TransferWidth = 0;
+    cfg.DMALLI = 0;
+
+    cfg.ChannelNum = SD_DMA_RX_CHANNEL;
+    cfg.TransferType = GPDMA_TRANSFERTYPE_P2M;
+    cfg.SrcConn = (_ssp == LPC_SSP0) ? GPDMA_CONN_SSP0_Rx : GPDMA_CONN_SSP1_Rx;
+    cfg.DstConn = 0;
+    cfg.SrcMemAddr = 0;
+    cfg.DstMemAddr = (uint32_t)((rx != NULL) ? (void *)rx : (void *)&_dma_sink);
+    if (GPDMA_Setup(&cfg) != SUCCESS)
+        return false;
+    if (rx == NULL)
+        SD_DMA_RX->DMACCControl &= ~GPDMA_DMACCxControl_DI;
+
+    _dma_fill = 0xFF;
+    cfg.ChannelNum = SD_DMA_TX_CHANNEL;
+    cfg.TransferType = GPDMA_TRANSFERTYPE_M2P;
+    cfg.SrcConn = 0;
+    cfg.DstConn = (_ssp == LPC_SSP0) ? GPDMA_CONN_SSP0_Tx : GPDMA_CONN_SSP1_Tx;
+    cfg.SrcMemAddr = (uint32_t)((tx != NULL) ? (const void *)tx : (const void *)&_dma_fill);
+    cfg.DstMemAddr = 0;
+    if (GPDMA_Setup(&cfg) != SUCCESS)
+        return false;
+    if (tx == NULL)
+        SD_DMA_TX->DMACCControl &= ~GPDMA_DMACCxControl_SI;
+
+    _ssp->DMACR = SSP_DMACR_RXDMAE | SSP_DMACR_TXDMAE;
+    GPDMA_ChannelCmd(SD_DMA_RX_CHANNEL, ENABLE);
+    GPDMA_ChannelCmd(SD_DMA_TX_CHANNEL, ENABLE);
+
+    // the channels disable themselves when done, the last byte received is the end of the transfer
+    while (LPC_GPDMA->DMACEnbldChns & (GPDMA_DMACEnbldChns_Ch(SD_DMA_RX_CHANNEL) | GPDMA_DMACEnbldChns_Ch(SD_DMA_TX_CHANNEL)));
+
+    _ssp->DMACR = 0;
+    GPDMA_ClearIntPending(GPDMA_STATCLR_INTTC, SD_DMA_RX_CHANNEL);
+    GPDMA_ClearIntPending(GPDMA_STATCLR_INTTC, SD_DMA_TX_CHANNEL);
+    return true;
 }
 
 static int ext_bits(char *data, int msb, int lsb) {
@@ -537,10 +759,17 @@ uint32_t SDCard::_sd_sectors() {
     }
 
     // csd_structure : csd[127:126]
+    // tran_speed    : csd[103:96] - the maximum clock
     // c_size        : csd[73:62]
     // c_size_mult   : csd[49:47]
     // read_bl_len   : csd[83:80] - the *maximum* read block length
 
+    // tran_speed is a mantissa times a power of ten, 0x32 is 2.5 x 10MHz
+    static const int tran_speed_mantissa[16] = {0, 10, 12, 13, 15, 20, 25, 30, 35, 40, 45, 50, 55, 60, 70, 80};
+    static const int tran_speed_unit[4] = {10000, 100000, 1000000, 10000000};
+    int tran_speed = ext_bits(csd, 103, 96);
+    _tran_speed = ((tran_speed & 7) < 4) ? tran_speed_mantissa[(tran_speed >> 3) & 15] * tran_speed_unit[tran_speed & 7] : 0;
+
     int csd_structure = ext_bits(csd, 127, 126);
 
     if (csd_structure == 0)
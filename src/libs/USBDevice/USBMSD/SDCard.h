@@ -56,9 +56,9 @@ public:
      * @param miso SPI miso pin conencted to SD Card
      * @param sclk SPI sclk pin connected to SD Card
      * @param cs   DigitalOut pin used as SD Card chip select
-     * @param name The name used to access the virtual filesystem
+     * @param max_frequency Upper limit for the SPI clock, the card's own limit is read from its CSD
      */
-    SDCard(PinName, PinName, PinName, PinName);
+    SDCard(PinName, PinName, PinName, PinName, int max_frequency= 25000000);
     virtual ~SDCard() {};
 
     typedef enum {
@@ -71,6 +71,8 @@ public:
     virtual int disk_initialize();
     virtual int disk_write(const char *buffer, uint32_t block_number);
     virtual int disk_read(char *buffer, uint32_t block_number);
+    virtual int disk_write_blocks(const char *buffer, uint32_t block_number, uint32_t count);
+    virtual int disk_read_blocks(char *buffer, uint32_t block_number, uint32_t count);
     virtual int disk_status();
     virtual int disk_sync();
     virtual uint32_t disk_sectors();
@@ -94,13 +96,27 @@ protected:
 
     int _read(char *buffer, int length);
     int _write(const char *buffer, int length);
+    int _read_data(char *buffer, int length);
+    int _write_data(const char *buffer, int length, int token);
+    int _stop_transmission();
+    bool _wait_ready(uint32_t timeout_us);
+    void _transfer(char *rx, const char *tx, int length);
+    bool _transfer_dma(char *rx, const char *tx, int length);
 
     uint32_t _sd_sectors();
     uint32_t _sectors;
+    int _tran_speed;
+    int _max_frequency;
 
     mbed::SPI _spi;
     GPIO _cs;
 
+    // the SSP behind _spi, its FIFO and DMA are used directly for data blocks
+    LPC_SSP_TypeDef *_ssp;
+    // DMA source of the 0xFF clocked out while reading and sink for what is read back while writing
+    uint8_t _dma_fill;
+    uint8_t _dma_sink;
+
     volatile bool busyflag;
 
     CARD_TYPE cardtype;
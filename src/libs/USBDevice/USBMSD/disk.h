@@ -23,6 +23,38 @@ public:
      */
     virtual int disk_write(const char * data, uint32_t block) { return 0; };
 
+    /*
+     * read count consecutive blocks, disks that can do this faster than a block at a time override it
+     *
+     * @param data pointer where will be stored read data
+     * @param block first block number
+     * @param count number of blocks
+     * @returns 0 if successful
+     */
+    virtual int disk_read_blocks(char * data, uint32_t block, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            int r = disk_read(data + i * 512, block + i);
+            if (r) return r;
+        }
+        return 0;
+    };
+
+    /*
+     * write count consecutive blocks
+     *
+     * @param data data to write
+     * @param block first block number
+     * @param count number of blocks
+     * @returns 0 if successful
+     */
+    virtual int disk_write_blocks(const char * data, uint32_t block, uint32_t count) {
+        for (uint32_t i = 0; i < count; i++) {
+            int r = disk_write(data + i * 512, block + i);
+            if (r) return r;
+        }
+        return 0;
+    };
+
     /*
      * Disk initilization
      */
@@ -24,6 +24,10 @@
 #include "libs/Kernel.h"
 #include "libs/SerialMessage.h"
 #include "StreamOutputPool.h"
+#include "Conveyor.h"
+#include "Config.h"
+#include "ConfigValue.h"
+#include "checksumm.h"
 
 #include "mbed.h"
 
@@ -38,10 +42,12 @@
     {                \
     } while (0)
 
-USBSerial::USBSerial(USB *u) : USBCDC(u), rxbuf(256 + 8), txbuf(128 + 8)
+#define usb_serial_rx_buffer_size_checksum CHECKSUM("usb_serial_rx_buffer_size")
+
+USBSerial::USBSerial(USB *u) : USBCDC(u), txbuf(128 + 8)
 {
     usb = u;
-    nl_in_rx = 0;
+    // rxbuf is allocated in on_module_loaded once its size is known, until then it takes nothing
     attach = attached = false;
     flush_to_nl = false;
     halt_flag = false;
@@ -84,33 +90,26 @@ int USBSerial::_getc()
 {
     if (!attached)
         return 0;
-    uint8_t c = 0;
+    char c = 0;
     setled(4, 1);
-    while (rxbuf.isEmpty())
+    while (!rxbuf.get_char(c))
         ;
     setled(4, 0);
-    rxbuf.dequeue(&c);
-    if (rxbuf.free() == MAX_PACKET_SIZE_EPBULK)
-    {
-        usb->endpointSetInterrupt(CDC_BulkOut.bEndpointAddress, true);
-        iprintf("rxbuf has room for another packet, interrupt enabled\n");
-    }
-    else if ((rxbuf.free() < MAX_PACKET_SIZE_EPBULK) && (nl_in_rx == 0))
+    if (rx_has_room())
     {
-        // handle potential deadlock where a short line, and the beginning of a very long line are bundled in one usb packet
-        rxbuf.flush();
-        flush_to_nl = true;
-
         usb->endpointSetInterrupt(CDC_BulkOut.bEndpointAddress, true);
         iprintf("rxbuf has room for another packet, interrupt enabled\n");
     }
-    if (nl_in_rx > 0)
-        if (c == '\n' || c == '\r')
-            nl_in_rx--;
 
     return c;
 }
 
+// a whole packet will fit, even one that is all newlines
+bool USBSerial::rx_has_room()
+{
+    return rxbuf.free() >= MAX_PACKET_SIZE_EPBULK && rxbuf.lines_free() >= MAX_PACKET_SIZE_EPBULK;
+}
+
 int USBSerial::puts(const char *str)
 {
     if (!attached)
@@ -203,7 +202,7 @@ bool USBSerial::USBEvent_EPOut(uint8_t bEP, uint8_t bEPStatus)
     if (bEP != CDC_BulkOut.bEndpointAddress)
         return false;
 
-    if (rxbuf.free() < MAX_PACKET_SIZE_EPBULK)
+    if (!rx_has_room())
     {
         //         usb->endpointSetInterrupt(bEP, false);
         return false;
@@ -221,8 +220,7 @@ bool USBSerial::USBEvent_EPOut(uint8_t bEP, uint8_t bEPStatus)
         // handle backspace and delete by deleting the last character in the buffer if there is one
         if (c[i] == 0x08 || c[i] == 0x7F)
         {
-            if (!rxbuf.isEmpty())
-                rxbuf.pop();
+            rxbuf.unput();
             continue;
         }
 
@@ -262,9 +260,6 @@ bool USBSerial::USBEvent_EPOut(uint8_t bEP, uint8_t bEPStatus)
 
         last_char_was_dollar = (c[i] == '$');
 
-        if (flush_to_nl == false)
-            rxbuf.queue(c[i]);
-
         // if (c[i] >= 32 && c[i] < 128)
         // {
         //     iprintf("%c", c[i]);
@@ -274,33 +269,31 @@ bool USBSerial::USBEvent_EPOut(uint8_t bEP, uint8_t bEPStatus)
         //     iprintf("\\x%02X", c[i]);
         // }
 
-        if (c[i] == '\n' || c[i] == '\r')
+        if (flush_to_nl)
         {
-            if (flush_to_nl)
+            if (c[i] == '\n' || c[i] == '\r')
                 flush_to_nl = false;
-            else
-                nl_in_rx++;
         }
-        else if (rxbuf.isFull() && (nl_in_rx == 0))
+        else if (!rxbuf.put(c[i]))
         {
-            // to avoid a deadlock with very long lines, we must dump the buffer
+            // to avoid a deadlock with very long lines, we must dump the line
             // and continue flushing to the next newline
-            rxbuf.flush();
+            rxbuf.drop_partial();
             flush_to_nl = true;
         }
     }
     iprintf("\nQueued, %d empty\n", rxbuf.free());
 
-    if (rxbuf.free() < MAX_PACKET_SIZE_EPBULK)
+    if (!rx_has_room())
     {
         // if buffer is full, stall endpoint, do not accept more data
         r = false;
 
-        if (nl_in_rx == 0)
+        if (rxbuf.lines() == 0)
         {
             // we have to check for long line deadlock here too
             flush_to_nl = true;
-            rxbuf.flush();
+            rxbuf.drop_partial();
 
             // and since our buffer is empty, we can accept more data
             r = true;
@@ -312,7 +305,12 @@ bool USBSerial::USBEvent_EPOut(uint8_t bEP, uint8_t bEPStatus)
     return r;
 }
 
-uint8_t USBSerial::available()
+int USBSerial::rx_free() const
+{
+    return rxbuf.free();
+}
+
+uint16_t USBSerial::available()
 {
     return rxbuf.available();
 }
@@ -324,6 +322,14 @@ bool USBSerial::ready()
 
 void USBSerial::on_module_loaded()
 {
+    // a bigger receive buffer lets a host stream further ahead
+    int n = THEKERNEL->config->value(usb_serial_rx_buffer_size_checksum)->by_default(256 + 8)->as_int();
+    if (n < 2 * MAX_PACKET_SIZE_EPBULK)
+        n = 2 * MAX_PACKET_SIZE_EPBULK;
+    __disable_irq();
+    rxbuf.allocate(n);
+    __enable_irq();
+
     this->register_for_event(ON_MAIN_LOOP);
     this->register_for_event(ON_IDLE);
 }
@@ -342,14 +348,16 @@ void USBSerial::on_idle(void *argument)
         {
             puts("HALTED, M999 or $X to exit HALT state\r\n");
         }
-        rxbuf.flush(); // flush the recieve buffer, hopefully upstream has stopped sending
-        nl_in_rx = 0;
+        // flush the recieve buffer, hopefully upstream has stopped sending
+        __disable_irq();
+        rxbuf.flush();
+        __enable_irq();
     }
 
     if (query_flag)
     {
         query_flag = false;
-        puts(THEKERNEL->get_query_string().c_str());
+        puts(THEKERNEL->get_query_string(this).c_str());
     }
 
     if (soft_stop_flag)
@@ -383,34 +391,30 @@ void USBSerial::on_main_loop(void *argument)
             attached = false;
             THEKERNEL->streams->remove_stream(this);
             txbuf.flush();
+            __disable_irq();
             rxbuf.flush();
-            nl_in_rx = 0;
+            __enable_irq();
         }
     }
 
     // if we are in feed hold we do not process anything
     //if(THEKERNEL->get_feed_hold()) return;
 
-    if (nl_in_rx)
+    if (rxbuf.lines() > 0)
     {
-        string received;
-        while (available())
+        // hand over the lines while the planner has room, rather than one per main loop
+        struct SerialMessage message;
+        message.stream = this;
+        int fed = 0;
+        while (rxbuf.get_line(message.message))
         {
-            char c = _getc();
-            if (c == '\n' || c == '\r')
-            {
-                struct SerialMessage message;
-                message.message = received;
-                message.stream = this;
-                iprintf("USBSerial Received: %s\n", message.message.c_str());
-                THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
-                return;
-            }
-            else
-            {
-                received += c;
-            }
+            iprintf("USBSerial Received: %s\n", message.message.c_str());
+            THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+            if (++fed >= 16 || THECONVEYOR->is_queue_full())
+                break;
         }
+        if (rx_has_room())
+            usb->endpointSetInterrupt(CDC_BulkOut.bEndpointAddress, true);
     }
 }
 
@@ -22,6 +22,7 @@
 #include "USBCDC.h"
 // #include "Stream.h"
 #include "CircBuffer.h"
+#include "LineRingBuffer.h"
 
 #include "Module.h"
 #include "StreamOutput.h"
@@ -41,12 +42,13 @@ public:
     int _getc();
     int puts(const char *);
 
-    uint8_t available();
+    uint16_t available();
+    int rx_free() const;
     bool ready();
 
     uint16_t writeBlock(const uint8_t *buf, uint16_t size);
 
-    CircBuffer<uint8_t> rxbuf;
+    LineRingBuffer rxbuf;
     CircBuffer<uint8_t> txbuf;
 
     void on_module_loaded(void);
@@ -64,10 +66,7 @@ protected:
     virtual void on_detach(void);
 
     bool ensure_tx_space(int);
-
-    // keep track of number of newlines in the buffer
-    // this makes it trivial to detect if there's a new line available
-    volatile int nl_in_rx;
+    bool rx_has_room();
 
     volatile struct
     {
@@ -142,6 +142,15 @@ string get_arguments( const string& possible_command )
     return possible_command.substr( beginning + 1, possible_command.size() - beginning + 1);
 }
 
+uint32_t hash_bytes(const void *data, size_t len, uint32_t hash)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+        hash = (hash ^ p[i]) * 16777619U;
+    }
+    return hash;
+}
+
 // Returns true if the file exists
 bool file_exists( const string file_name )
 {
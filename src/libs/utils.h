@@ -23,6 +23,9 @@ uint16_t get_checksum(const char* to_check);
 
 void get_checksums(uint16_t check_sums[], const std::string& key);
 
+// FNV-1a, pass the result back in as hash to continue it over more data
+uint32_t hash_bytes(const void *data, size_t len, uint32_t hash= 2166136261U);
+
 std::string shift_parameter( std::string &parameters );
 
 std::string get_arguments( const std::string& possible_command );
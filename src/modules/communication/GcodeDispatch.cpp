@@ -27,6 +27,9 @@
 #include "LPC17xx.h"
 #include "version.h"
 
+#include <stdlib.h>
+#include <string.h>
+
 #define panel_display_message_checksum CHECKSUM("display_message")
 #define panel_checksum CHECKSUM("panel")
 
@@ -55,10 +58,204 @@ void GcodeDispatch::on_module_loaded()
     this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
 }
 
+// The ok for a streamed line, with report_buffers set it also says how many planner blocks and receive buffer
+// bytes are free so the host can keep several lines in flight. For a G1 the ok goes before it is planned, so
+// the blocks are one high then
+void GcodeDispatch::send_ok(StreamOutput *stream, const char *eol)
+{
+    if (!THEKERNEL->is_report_buffers())
+    {
+        stream->printf("ok%s", eol);
+        return;
+    }
+
+    int rx = stream->rx_free();
+    unsigned blocks = THECONVEYOR->get_queue_free();
+    if (rx >= 0)
+        stream->printf("ok Bf:%u,%d%s", blocks, rx, eol);
+    else
+        stream->printf("ok Bf:%u%s", blocks, eol);
+}
+
+void GcodeDispatch::dispatch_decoded(Gcode *gcode, StreamOutput *stream)
+{
+    // remember last modal group 1 code, so a following line with only coordinates continues it
+    if (gcode->has_g && gcode->g < 4)
+        modal_group_1 = gcode->g;
+
+    dispatch_gcode(gcode, stream, false, true);
+}
+
+// Dispatch one command to the modules and reply to the host
+void GcodeDispatch::dispatch_gcode(Gcode *gcode, StreamOutput *stream, bool sent_ok, bool last_on_line)
+{
+    //Dispatch message!
+    THEKERNEL->call_event(ON_GCODE_RECEIVED, gcode);
+
+    if (gcode->is_error)
+    {
+        // report error
+        if (THEKERNEL->is_grbl_mode())
+        {
+            stream->printf("error:");
+        }
+        else
+        {
+            stream->printf("Error: ");
+        }
+
+        if (!gcode->txt_after_ok.empty())
+        {
+            stream->printf("%s\r\n", gcode->txt_after_ok.c_str());
+            gcode->txt_after_ok.clear();
+        }
+        else
+        {
+            stream->printf("unknown\r\n");
+        }
+
+        // we cannot continue safely after an error so we enter HALT state
+        stream->printf("Entering Alarm/Halt state\n");
+        THEKERNEL->call_event(ON_HALT, nullptr);
+    }
+    else if (!sent_ok)
+    {
+
+        if (gcode->add_nl)
+            stream->printf("\r\n");
+
+        if (!gcode->txt_after_ok.empty())
+        {
+            stream->printf("ok %s\r\n", gcode->txt_after_ok.c_str());
+            gcode->txt_after_ok.clear();
+        }
+        else
+        {
+            if (THEKERNEL->is_ok_per_line() || THEKERNEL->is_grbl_mode())
+            {
+                // only send ok once per line if this is a multi g code line send ok on the last one
+                if (last_on_line)
+                    send_ok(stream, "\r\n");
+            }
+            else
+            {
+                // maybe should do the above for all hosts?
+                send_ok(stream, "\r\n");
+            }
+        }
+    }
+}
+
+// The common streaming case of a line holding a single G command, optionally with a line number and checksum, is
+// parsed in place in a line buffer on the stack and dispatched as a Gcode on the stack, so it uses no heap.
+// The buffer has to be on the stack as modules can send console lines while handling a Gcode.
+// Returns false if the line needs the general path below, nothing has been changed in that case.
+bool GcodeDispatch::dispatch_in_place(const SerialMessage &message)
+{
+    if (uploading || THEKERNEL->is_halted())
+        return false;
+
+    // leave room in front for a G0 to G3 modal prefix
+    size_t len = message.message.size();
+    if (len == 0 || len + 4 > in_place_line_size)
+        return false;
+
+    char buf[in_place_line_size];
+    char *line = buf + 4;
+    memcpy(line, message.message.data(), len);
+    line[len] = '\0';
+
+    char first_char = line[0];
+    int ln = currentline + 1;
+
+    if (first_char == 'N')
+    {
+        // M110 sets the line number, leave anything with an M to the general path
+        if (strchr(line, 'M') != nullptr)
+            return false;
+
+        char *p;
+        ln = strtol(line + 1, &p, 10);
+        if (p == line + 1)
+            return false;
+
+        char *chk = strchr(line, '*');
+        if (chk != nullptr)
+        {
+            int chksum = strtol(chk + 1, &p, 10);
+            if (p == chk + 1)
+                return false;
+
+            int cs = 0;
+            for (char *c = line; c < chk; c++)
+                cs = cs ^ *c;
+            // a bad checksum asks for a resend, which the general path does
+            if ((cs & 0xff) != chksum)
+                return false;
+            *chk = '\0';
+        }
+
+        if (ln != currentline + 1)
+            return false;
+
+        // strip line number
+        line += strspn(line, "N0123456789.,- ");
+    }
+    else if (first_char == 'X' || first_char == 'Y' || first_char == 'Z' || first_char == 'F')
+    {
+        // pycam syntax, use last modal group 1 command, F on its own always applies to G1
+        line -= 3;
+        line[0] = 'G';
+        line[1] = (first_char == 'F') ? '1' : '0' + modal_group_1;
+        line[2] = ' ';
+    }
+    else if (first_char != 'G')
+    {
+        return false;
+    }
+
+    // Remove comments
+    char *comment = strpbrk(line, ";(");
+    if (comment != nullptr)
+        *comment = '\0';
+
+    // only one G command and no M codes on the line
+    if (line[0] != 'G' || strchr(line, 'M') != nullptr || (line[1] != '\0' && strchr(line + 2, 'G') != nullptr))
+        return false;
+
+    Gcode gcode(line, message.stream, true, true);
+
+    // G53 applies to the next G0/G1 and may need the rest of the line
+    if (gcode.g == 53)
+        return false;
+
+    if (first_char == 'N')
+        currentline = ln;
+
+    bool sent_ok = false;
+    if (gcode.g == 1)
+    {
+        // optimize G1 to send ok immediately (one per line) before it is planned
+        sent_ok = true;
+        send_ok(message.stream, "\n");
+    }
+
+    // remember last modal group 1 code
+    if (gcode.g < 4)
+        modal_group_1 = gcode.g;
+
+    dispatch_gcode(&gcode, message.stream, sent_ok, true);
+    return true;
+}
+
 // When a command is received, if it is a Gcode, dispatch it as an object via an event
 void GcodeDispatch::on_console_line_received(void *line)
 {
-    SerialMessage new_message = *static_cast<SerialMessage *>(line);
+    SerialMessage &new_message = *static_cast<SerialMessage *>(line);
+
+    if (dispatch_in_place(new_message))
+        return;
+
     string possible_command = new_message.message;
 
     int ln = 0;
@@ -67,7 +264,7 @@ void GcodeDispatch::on_console_line_received(void *line)
     // just reply ok to empty lines
     if (possible_command.empty())
     {
-        new_message.stream->printf("ok\r\n");
+        send_ok(new_message.stream, "\r\n");
         return;
     }
 
@@ -250,7 +447,7 @@ try_again:
                             if (!sent_ok)
                             {
                                 sent_ok = true;
-                                new_message.stream->printf("ok\n");
+                                send_ok(new_message.stream, "\n");
                             }
                         }
 
@@ -438,63 +635,7 @@ try_again:
                         }
                     }
 
-                    //printf("dispatch %p: '%s' G%d M%d...", gcode, gcode->command.c_str(), gcode->g, gcode->m);
-                    //Dispatch message!
-                    THEKERNEL->call_event(ON_GCODE_RECEIVED, gcode);
-
-                    if (gcode->is_error)
-                    {
-                        // report error
-                        if (THEKERNEL->is_grbl_mode())
-                        {
-                            new_message.stream->printf("error:");
-                        }
-                        else
-                        {
-                            new_message.stream->printf("Error: ");
-                        }
-
-                        if (!gcode->txt_after_ok.empty())
-                        {
-                            new_message.stream->printf("%s\r\n", gcode->txt_after_ok.c_str());
-                            gcode->txt_after_ok.clear();
-                        }
-                        else
-                        {
-                            new_message.stream->printf("unknown\r\n");
-                        }
-
-                        // we cannot continue safely after an error so we enter HALT state
-                        new_message.stream->printf("Entering Alarm/Halt state\n");
-                        THEKERNEL->call_event(ON_HALT, nullptr);
-                    }
-                    else if (!sent_ok)
-                    {
-
-                        if (gcode->add_nl)
-                            new_message.stream->printf("\r\n");
-
-                        if (!gcode->txt_after_ok.empty())
-                        {
-                            new_message.stream->printf("ok %s\r\n", gcode->txt_after_ok.c_str());
-                            gcode->txt_after_ok.clear();
-                        }
-                        else
-                        {
-                            if (THEKERNEL->is_ok_per_line() || THEKERNEL->is_grbl_mode())
-                            {
-                                // only send ok once per line if this is a multi g code line send ok on the last one
-                                if (possible_command.empty())
-                                    new_message.stream->printf("ok\r\n");
-                            }
-                            else
-                            {
-                                // maybe should do the above for all hosts?
-                                new_message.stream->printf("ok\r\n");
-                            }
-                        }
-                    }
-
+                    dispatch_gcode(gcode, new_message.stream, sent_ok, possible_command.empty());
                     delete gcode;
                 }
                 else
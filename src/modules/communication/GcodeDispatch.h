@@ -13,6 +13,8 @@
 #include <string>
 
 class StreamOutput;
+class Gcode;
+struct SerialMessage;
 
 class GcodeDispatch : public Module
 {
@@ -23,7 +25,16 @@ public:
     virtual void on_console_line_received(void *line);
 
     uint8_t get_modal_command() const { return modal_group_1<4 ? modal_group_1 : 0; }
+    // dispatches a command that was decoded elsewhere, like the moves of a compact file, as if it had been a line
+    void dispatch_decoded(Gcode *gcode, StreamOutput *stream);
 private:
+    bool dispatch_in_place(const SerialMessage &message);
+    void dispatch_gcode(Gcode *gcode, StreamOutput *stream, bool sent_ok, bool last_on_line);
+    void send_ok(StreamOutput *stream, const char *eol);
+
+    // longest line handled by dispatch_in_place()
+    static const size_t in_place_line_size= 128;
+
     int currentline;
     std::string upload_filename;
     FILE *upload_fd;
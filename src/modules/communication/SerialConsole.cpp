@@ -12,10 +12,15 @@ using std::string;
 #include "libs/Kernel.h"
 #include "libs/nuts_bolts.h"
 #include "SerialConsole.h"
-#include "libs/RingBuffer.h"
+#include "libs/Config.h"
+#include "libs/ConfigValue.h"
+#include "libs/checksumm.h"
 #include "libs/SerialMessage.h"
 #include "libs/StreamOutput.h"
 #include "libs/StreamOutputPool.h"
+#include "Conveyor.h"
+
+#define uart0_checksum CHECKSUM("uart0")
 
 // Serial reading module
 // Treats every received line as a command and passes it ( via event call ) to the command dispatcher.
@@ -29,11 +34,16 @@ SerialConsole::SerialConsole(PinName rx_pin, PinName tx_pin, int baud_rate)
 // Called when the module has just been loaded
 void SerialConsole::on_module_loaded()
 {
-    // We want to be called every time a new char is received
-    this->serial->attach(this, &SerialConsole::on_serial_char_received, mbed::Serial::RxIrq);
     query_flag = false;
     halt_flag = false;
     soft_stop_flag = false;
+    discard_flag = false;
+
+    // a host streaming over the uart can get further ahead with a bigger buffer
+    this->buffer.allocate(THEKERNEL->config->value(uart0_checksum, rx_buffer_size_setting_checksum)->by_default(256)->as_number());
+
+    // We want to be called every time a new char is received
+    this->serial->attach(this, &SerialConsole::on_serial_char_received, mbed::Serial::RxIrq);
 
     // We only call the command dispatcher in the main loop, nowhere else
     this->register_for_event(ON_MAIN_LOOP);
@@ -69,7 +79,18 @@ void SerialConsole::on_serial_char_received()
         {
             received = '\n';
         }
-        this->buffer.push_back(received);
+        if (discard_flag)
+        {
+            if (received == '\n')
+                discard_flag = false;
+            continue;
+        }
+        if (!this->buffer.put(received))
+        {
+            // no room, drop the line rather than run part of it
+            this->buffer.drop_partial();
+            discard_flag = received != '\n';
+        }
     }
 }
 
@@ -78,7 +99,7 @@ void SerialConsole::on_idle(void *argument)
     if (query_flag)
     {
         query_flag = false;
-        puts(THEKERNEL->get_query_string().c_str());
+        puts(THEKERNEL->get_query_string(this).c_str());
     }
     if (soft_stop_flag)
     {
@@ -103,27 +124,15 @@ void SerialConsole::on_idle(void *argument)
 // Actual event calling must happen in the main loop because if it happens in the interrupt we will loose data
 void SerialConsole::on_main_loop(void *argument)
 {
-    if (this->has_char('\n'))
+    // several lines at a time, as long as the planner takes them without waiting
+    struct SerialMessage message;
+    message.stream = this;
+    int fed = 0;
+    while (this->buffer.get_line(message.message))
     {
-        string received;
-        received.reserve(20);
-        while (1)
-        {
-            char c;
-            this->buffer.pop_front(c);
-            if (c == '\n')
-            {
-                struct SerialMessage message;
-                message.message = received;
-                message.stream = this;
-                THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
-                return;
-            }
-            else
-            {
-                received += c;
-            }
-        }
+        THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+        if (++fed >= 16 || THECONVEYOR->is_queue_full())
+            break;
     }
 }
 
@@ -147,18 +156,3 @@ int SerialConsole::_getc()
 {
     return this->serial->getc();
 }
-
-// Does the queue have a given char ?
-bool SerialConsole::has_char(char letter)
-{
-    int index = this->buffer.tail;
-    while (index != this->buffer.head)
-    {
-        if (this->buffer.buffer[index] == letter)
-        {
-            return true;
-        }
-        index = this->buffer.next_block_index(index);
-    }
-    return false;
-}
@@ -14,10 +14,11 @@
 #include <vector>
 #include <string>
 using std::string;
-#include "libs/RingBuffer.h"
+#include "libs/LineRingBuffer.h"
 #include "libs/StreamOutput.h"
 
 #define baud_rate_setting_checksum CHECKSUM("baud_rate")
+#define rx_buffer_size_setting_checksum CHECKSUM("rx_buffer_size")
 
 class SerialConsole : public Module, public StreamOutput
 {
@@ -28,21 +29,22 @@ public:
   void on_serial_char_received();
   void on_main_loop(void *argument);
   void on_idle(void *argument);
-  bool has_char(char letter);
 
   int _putc(int c);
   int _getc(void);
   int puts(const char *);
+  int rx_free() const { return buffer.free(); }
 
   //string receive_buffer;                 // Received chars are stored here until a newline character is received
   //vector<std::string> received_lines;    // Received lines are stored here until they are requested
-  RingBuffer<char, 256> buffer; // Receive buffer
+  LineRingBuffer buffer; // Receive buffer
   mbed::Serial *serial;
   struct
   {
     bool query_flag : 1;
     bool halt_flag : 1;
     bool soft_stop_flag : 1;
+    bool discard_flag : 1; // dropping the rest of a line that did not fit
   };
 };
 
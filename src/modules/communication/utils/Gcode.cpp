@@ -10,26 +10,61 @@
 #include "libs/StreamOutput.h"
 #include "utils.h"
 #include <stdlib.h>
+#include <string.h>
 #include <algorithm>
 
 // This is a gcode object. It represents a GCode string/command, and caches some important values about that command for the sake of performance.
 // It gets passed around in events, and attached to the queue ( that'll change )
-Gcode::Gcode(const string &command, StreamOutput *stream, bool strip)
+Gcode::Gcode(const string &command, StreamOutput *stream, bool strip) : Gcode((char *)command.c_str(), stream, strip, false)
 {
-    this->command= strdup(command.c_str());
+}
+
+Gcode::Gcode(char *line, StreamOutput *stream, bool strip, bool in_place)
+{
+    this->command= in_place ? line : strdup(line);
+    this->owns_command= !in_place;
     this->m= 0;
     this->g= 0;
     this->subcode= 0;
     this->add_nl= false;
     this->is_error= false;
+    this->decoded= false;
     this->stream= stream;
     prepare_cached_values(strip);
     this->stripped= strip;
 }
 
+Gcode::Gcode(unsigned int g, char *params, const float *values, StreamOutput *stream)
+{
+    this->command= params;
+    this->owns_command= false;
+    this->m= 0;
+    this->g= g;
+    this->has_m= false;
+    this->has_g= true;
+    this->subcode= 0;
+    this->add_nl= false;
+    this->is_error= false;
+    this->decoded= true;
+    this->stripped= true;
+    this->stream= stream;
+
+    // fill the word table straight from the values, each word is just its letter in command
+    letters= 0;
+    num_words= 0;
+    words_overflow= false;
+    for (int i = 0; params[i] != '\0' && i < max_words; ++i) {
+        letters |= 1 << (params[i] - 'A');
+        words[i].value= values[i];
+        words[i].pos= i;
+        words[i].end= i + 1;
+        ++num_words;
+    }
+}
+
 Gcode::~Gcode()
 {
-    if(command != nullptr) {
+    if(command != nullptr && owns_command) {
         // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
         free(command);
     }
@@ -38,6 +73,7 @@ Gcode::~Gcode()
 Gcode::Gcode(const Gcode &to_copy)
 {
     this->command               = strdup(to_copy.command); // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
+    this->owns_command          = true;
     this->has_m                 = to_copy.has_m;
     this->has_g                 = to_copy.has_g;
     this->m                     = to_copy.m;
@@ -45,14 +81,22 @@ Gcode::Gcode(const Gcode &to_copy)
     this->subcode               = to_copy.subcode;
     this->add_nl                = to_copy.add_nl;
     this->is_error              = to_copy.is_error;
+    this->decoded               = to_copy.decoded;
     this->stream                = to_copy.stream;
     this->txt_after_ok.assign( to_copy.txt_after_ok );
+    // offsets into command are the same in the copy
+    memcpy(this->words, to_copy.words, sizeof(this->words));
+    this->letters               = to_copy.letters;
+    this->num_words             = to_copy.num_words;
+    this->words_overflow        = to_copy.words_overflow;
 }
 
 Gcode &Gcode::operator= (const Gcode &to_copy)
 {
     if( this != &to_copy ) {
+        if(owns_command) free(this->command);
         this->command               = strdup(to_copy.command); // TODO we can reference count this so we share copies, may save more ram than the extra count we need to store
+        this->owns_command          = true;
         this->has_m                 = to_copy.has_m;
         this->has_g                 = to_copy.has_g;
         this->m                     = to_copy.m;
@@ -60,74 +104,159 @@ Gcode &Gcode::operator= (const Gcode &to_copy)
         this->subcode               = to_copy.subcode;
         this->add_nl                = to_copy.add_nl;
         this->is_error              = to_copy.is_error;
+        this->decoded               = to_copy.decoded;
         this->stream                = to_copy.stream;
         this->txt_after_ok.assign( to_copy.txt_after_ok );
+        memcpy(this->words, to_copy.words, sizeof(this->words));
+        this->letters               = to_copy.letters;
+        this->num_words             = to_copy.num_words;
+        this->words_overflow        = to_copy.words_overflow;
     }
     return *this;
 }
 
 
-// Whether or not a Gcode has a letter
-bool Gcode::has_letter( char letter ) const
+// find the first occurrence of letter that is followed by a number, ptr is set to the end of the number
+static float scan_value(const char *cs, char letter, char **ptr)
 {
-    for (size_t i = 0; i < strlen(this->command); ++i) {
-        if( command[i] == letter ) {
-            return true;
-        }
-    }
-    return false;
-}
-
-// Retrieve the value for a given letter
-float Gcode::get_value( char letter, char **ptr ) const
-{
-    const char *cs = command;
     char *cn = NULL;
     for (; *cs; cs++) {
         if( letter == *cs ) {
-            cs++;
-            float r = strtof(cs, &cn);
-            if(ptr != nullptr) *ptr= cn;
-            if (cn > cs)
+            float r = strtof(cs + 1, &cn);
+            if (cn > cs + 1) {
+                if(ptr != nullptr) *ptr= cn;
                 return r;
+            }
         }
     }
     if(ptr != nullptr) *ptr= nullptr;
     return 0;
 }
 
-int Gcode::get_int( char letter, char **ptr ) const
+// same for an integer, base 10
+static long scan_int(const char *cs, char letter, char **ptr, bool is_unsigned)
 {
-    const char *cs = command;
     char *cn = NULL;
     for (; *cs; cs++) {
         if( letter == *cs ) {
-            cs++;
-            int r = strtol(cs, &cn, 10);
-            if(ptr != nullptr) *ptr= cn;
-            if (cn > cs)
+            long r = is_unsigned ? strtoul(cs + 1, &cn, 10) : strtol(cs + 1, &cn, 10);
+            if (cn > cs + 1) {
+                if(ptr != nullptr) *ptr= cn;
                 return r;
+            }
         }
     }
     if(ptr != nullptr) *ptr= nullptr;
     return 0;
 }
 
-uint32_t Gcode::get_uint( char letter, char **ptr ) const
+// Parse the command once into a table of letter -> value, for each letter the first occurrence that has a number after it
+void Gcode::parse_words()
 {
-    const char *cs = command;
-    char *cn = NULL;
-    for (; *cs; cs++) {
-        if( letter == *cs ) {
-            cs++;
-            int r = strtoul(cs, &cn, 10);
-            if(ptr != nullptr) *ptr= cn;
-            if (cn > cs)
-                return r;
+    letters= 0;
+    num_words= 0;
+    words_overflow= false;
+
+    for (const char *cs = command; *cs; cs++) {
+        char c= *cs;
+        if(c < 'A' || c > 'Z') continue;
+
+        uint32_t bit= 1 << (c - 'A');
+        if((letters & bit) && find_word(c) >= 0) continue; // already have a value for this letter
+        letters |= bit;
+
+        char *cn;
+        float r= strtof(cs + 1, &cn);
+        if(cn == cs + 1) continue; // not a number, a later occurrence may be
+
+        if(num_words >= max_words || cn - command > 0xFFFF) {
+            words_overflow= true;
+            continue;
         }
+
+        words[num_words].value= r;
+        words[num_words].pos= cs - command;
+        words[num_words].end= cn - command;
+        ++num_words;
     }
-    if(ptr != nullptr) *ptr= nullptr;
-    return 0;
+}
+
+// return the index of the word for the letter or -1 if it is not in the table
+int Gcode::find_word(char letter) const
+{
+    for (int i = 0; i < num_words; ++i) {
+        if(command[words[i].pos] == letter) return i;
+    }
+    return -1;
+}
+
+// Whether or not a Gcode has a letter
+bool Gcode::has_letter( char letter ) const
+{
+    if(letter >= 'A' && letter <= 'Z') {
+        return (letters & (1 << (letter - 'A'))) != 0;
+    }
+    return strchr(this->command, letter) != nullptr;
+}
+
+// Retrieve the value for a given letter
+float Gcode::get_value( char letter, char **ptr ) const
+{
+    if(letter < 'A' || letter > 'Z' || words_overflow) {
+        return scan_value(command, letter, ptr);
+    }
+
+    int i= find_word(letter);
+    if(i < 0) {
+        if(ptr != nullptr) *ptr= nullptr;
+        return 0;
+    }
+
+    if(ptr != nullptr) *ptr= command + words[i].end;
+    return words[i].value;
+}
+
+int Gcode::get_int( char letter, char **ptr ) const
+{
+    if(letter < 'A' || letter > 'Z' || words_overflow) {
+        return scan_int(command, letter, ptr, false);
+    }
+
+    // anything strtol can read strtof can read, so if there is no word there is no integer either
+    int i= find_word(letter);
+    if(i < 0) {
+        if(ptr != nullptr) *ptr= nullptr;
+        return 0;
+    }
+
+    // a decoded command has no numbers in its text
+    if(decoded) {
+        if(ptr != nullptr) *ptr= command + words[i].end;
+        return words[i].value;
+    }
+
+    // start at the word, if it is not an integer (eg X.5) this carries on to any later occurrence
+    return scan_int(command + words[i].pos, letter, ptr, false);
+}
+
+uint32_t Gcode::get_uint( char letter, char **ptr ) const
+{
+    if(letter < 'A' || letter > 'Z' || words_overflow) {
+        return scan_int(command, letter, ptr, true);
+    }
+
+    int i= find_word(letter);
+    if(i < 0) {
+        if(ptr != nullptr) *ptr= nullptr;
+        return 0;
+    }
+
+    if(decoded) {
+        if(ptr != nullptr) *ptr= command + words[i].end;
+        return words[i].value;
+    }
+
+    return scan_int(command + words[i].pos, letter, ptr, true);
 }
 
 int Gcode::get_num_args() const
@@ -171,18 +300,19 @@ std::map<char,int> Gcode::get_args_int() const
 // Cache some of this command's properties, so we don't have to parse the string every time we want to look at them
 void Gcode::prepare_cached_values(bool strip)
 {
+    // G and M are found by scanning, the word table is built once the command has been stripped
     char *p= nullptr;
-    if( this->has_letter('G') ) {
+    if( strchr(this->command, 'G') != nullptr ) {
         this->has_g = true;
-        this->g = this->get_int('G', &p);
+        this->g = scan_int(this->command, 'G', &p, false);
 
     } else {
         this->has_g = false;
     }
 
-    if( this->has_letter('M') ) {
+    if( strchr(this->command, 'M') != nullptr ) {
         this->has_m = true;
-        this->m = this->get_int('M', &p);
+        this->m = scan_int(this->command, 'M', &p, false);
 
     } else {
         this->has_m = false;
@@ -198,14 +328,18 @@ void Gcode::prepare_cached_values(bool strip)
         }
     }
 
-    if(!strip) return;
-
     // remove the Gxxx or Mxxx from string
-    if (p != nullptr) {
-        char *n= strdup(p); // create new string starting at end of the numeric value
-        free(command);
-        command= n;
+    if (strip && p != nullptr) {
+        if(owns_command) {
+            char *n= strdup(p); // create new string starting at end of the numeric value
+            free(command);
+            command= n;
+        }else{
+            command= p; // the caller owns the line so just skip over the Gxxx
+        }
     }
+
+    parse_words();
 }
 
 // strip off X Y Z I J K parameters if G0/1/2/3
@@ -235,8 +369,10 @@ void Gcode::strip_parameters()
         //newcmd.erase(std::remove_if(newcmd.begin(), newcmd.end(), ::isspace), newcmd.end());
 
         // release the old one
-        free(command);
+        if(owns_command) free(command);
         // copy the new shortened one
         command= strdup(newcmd.c_str());
+        owns_command= true;
+        parse_words();
     }
 }
@@ -10,6 +10,7 @@
 #define GCODE_H
 #include <string>
 #include <map>
+#include <stdint.h>
 
 using std::string;
 
@@ -19,6 +20,11 @@ class StreamOutput;
 class Gcode {
     public:
         Gcode(const string&, StreamOutput*, bool strip=true);
+        // in_place uses line as the command without copying it, so line must outlive the Gcode and not change while it is used
+        Gcode(char *line, StreamOutput*, bool strip, bool in_place);
+        // a G command that has already been decoded, eg from a compact binary file, nothing is parsed.
+        // params holds just the parameter letters (eg "XYF") and values one value per letter, params is used in place as above
+        Gcode(unsigned int g, char *params, const float *values, StreamOutput*);
         Gcode(const Gcode& to_copy);
         Gcode& operator= (const Gcode& to_copy);
         ~Gcode();
@@ -43,6 +49,7 @@ class Gcode {
             bool has_g:1;
             bool stripped:1;
             bool is_error:1;
+            bool decoded:1;
             uint8_t subcode:3;
         };
 
@@ -51,6 +58,21 @@ class Gcode {
 
     private:
         void prepare_cached_values(bool strip=true);
+        void parse_words();
+        int find_word(char letter) const;
         char *command;
+        bool owns_command;          // command was allocated by us and is freed with the Gcode
+
+        // every letter is parsed once when the command is set, has_letter() and the get_xxx() calls are served from here
+        static const int max_words= 12;
+        struct word_t {
+            float value;
+            uint16_t pos;           // offset of the letter in command
+            uint16_t end;           // offset of the first character after the value
+        };
+        word_t words[max_words];    // first occurrence of each letter that is followed by a number
+        uint32_t letters;           // bit per letter A-Z that appears anywhere in command
+        uint8_t num_words;
+        bool words_overflow;        // more numeric words than max_words, the rest are found by scanning command
 };
 #endif
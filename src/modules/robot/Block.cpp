@@ -26,6 +26,7 @@ using std::string;
 #define STEP_TICKER_FREQUENCY THEKERNEL->step_ticker->get_frequency()
 
 uint8_t Block::n_actuators= 0;
+bool Block::s_curve= false;
 double Block::fp_scale= 0;
 
 // A block represents a movement, it's length for each stepper motor, and the corresponding acceleration curves.
@@ -36,12 +37,14 @@ double Block::fp_scale= 0;
 Block::Block()
 {
     tick_info= nullptr;
+    s_curve_info= nullptr;
     clear();
 }
 
-void Block::init(uint8_t n)
+void Block::init(uint8_t n, bool s)
 {
     n_actuators= n;
+    s_curve= s;
     fp_scale= (double)STEPTICKER_FPSCALE / pow((double)STEP_TICKER_FREQUENCY, 2.0); // we scale up by fixed point offset first to avoid tiny values
 }
 
@@ -68,6 +71,7 @@ void Block::clear()
     is_ticking          = false;
     is_g123             = false;
     locked              = false;
+    is_s_curve          = false;
     s_value             = 0.0F;
 
     total_move_ticks= 0;
@@ -92,6 +96,18 @@ void Block::clear()
         tick_info[i].step_count= 0;
         tick_info[i].next_accel_event= 0;
     }
+
+    if(s_curve) {
+        if(s_curve_info == nullptr) {
+            s_curve_info= new s_curve_info_t[n_actuators];
+            if(s_curve_info == nullptr) __debugbreak();
+        }
+        for(int i = 0; i < n_actuators; ++i) {
+            s_curve_info[i].jerk= 0;
+            s_curve_info[i].snap= 0;
+            s_curve_info[i].decel_snap= 0;
+        }
+    }
 }
 
 void Block::debug() const
@@ -144,7 +160,7 @@ void Block::calculate_trapezoid( float entryspeed, float exitspeed )
     //printf("Initial rate: %f, final_rate: %f\n", initial_rate, final_rate);
     // How many steps ( can be fractions of steps, we need very precise values ) to accelerate and decelerate
     // This is a simplification to get rid of rate_delta and get the steps/s² accel directly from the mm/s² accel
-    float acceleration_per_second = (this->acceleration * this->steps_event_count) / this->millimeters;
+    float acceleration_per_second = (this->ramp_acceleration() * this->steps_event_count) / this->millimeters;
 
     float maximum_possible_rate = sqrtf( ( this->steps_event_count * acceleration_per_second ) + ( ( powf(initial_rate, 2) + powf(final_rate, 2) ) / 2.0F ) );
 
@@ -243,7 +259,7 @@ float Block::reverse_pass(float exit_speed)
         // If nominal length true, max junction speed is guaranteed to be reached. Only compute
         // for max allowable speed if block is decelerating and nominal length is false.
         if ((!this->nominal_length_flag) && (this->max_entry_speed > exit_speed)) {
-            float max_entry_speed = max_allowable_speed(-this->acceleration, exit_speed, this->millimeters);
+            float max_entry_speed = max_allowable_speed(-this->ramp_acceleration(), exit_speed, this->millimeters);
 
             this->entry_speed = min(max_entry_speed, this->max_entry_speed);
 
@@ -298,13 +314,25 @@ float Block::max_exit_speed()
         return nominal_speed;
 
     // otherwise, we have to work out max exit speed based on entry and acceleration
-    float max = max_allowable_speed(-this->acceleration, this->entry_speed, this->millimeters);
+    float max = max_allowable_speed(-this->ramp_acceleration(), this->entry_speed, this->millimeters);
 
     return min(max, nominal_speed);
 }
 
 // prepare block for the step ticker, called everytime the block changes
 // this is done during planning so does not delay tick generation and step ticker can simply grab the next block during the interrupt
+// The s-curve ramps change the speed by the same amount in the same number of ticks as the linear ones, following
+// v(t)= v0 + a*T*(3u² - 2u³) where u= t/T, so the acceleration is zero at both ends and 1.5 times a in the middle,
+// a being the 2/3 of the configured acceleration given by ramp_acceleration().
+// As v is a cubic in t the step ticker integrates it with forward differences, these are the first three at t= 0.
+static void s_curve_differences(double acceleration_per_tick, uint32_t ticks, int64_t& d1, int64_t& d2, int64_t& d3)
+{
+    double t2= (double)ticks * ticks;
+    d1= (int64_t)round(acceleration_per_tick * (3.0 * ticks - 2.0) / t2);
+    d2= (int64_t)round(acceleration_per_tick * (6.0 * ticks - 12.0) / t2);
+    d3= (int64_t)round(acceleration_per_tick * -12.0 / t2);
+}
+
 void Block::prepare(float acceleration_in_steps, float deceleration_in_steps)
 {
 
@@ -350,6 +378,35 @@ void Block::prepare(float acceleration_in_steps, float deceleration_in_steps)
         this->tick_info[m].deceleration_change= -(int64_t)round(deceleration_per_tick * aratio);
         this->tick_info[m].plateau_rate= (int64_t)round(((this->maximum_rate * aratio) / STEP_TICKER_FREQUENCY) * STEPTICKER_FPSCALE);
 
+        if(this->is_s_curve) {
+            s_curve_info_t& sc= this->s_curve_info[m];
+            sc.jerk= 0;
+            sc.snap= 0;
+            sc.decel_snap= 0;
+
+            // ramps of two ticks or less stay linear
+            int64_t d1, d2, d3;
+            uint32_t deceleration_ticks= this->total_move_ticks - this->decelerate_after;
+            if(deceleration_ticks > 2) {
+                s_curve_differences(-deceleration_per_tick * aratio, deceleration_ticks, d1, d2, d3);
+                this->tick_info[m].deceleration_change= d1;
+                sc.decel_snap= d3;
+            }
+
+            if(this->accelerate_until > 2) {
+                s_curve_differences(acceleration_per_tick * aratio, this->accelerate_until, d1, d2, d3);
+                this->tick_info[m].acceleration_change= d1;
+                sc.jerk= d2;
+                sc.snap= d3;
+
+            } else if(this->accelerate_until == 0 && this->decelerate_after == 0 && deceleration_ticks > 2) {
+                // we start off decelerating so there is no decel event to set the jerk
+                this->tick_info[m].acceleration_change= this->tick_info[m].deceleration_change;
+                sc.jerk= -(sc.decel_snap * (deceleration_ticks - 2)) / 2;
+                sc.snap= sc.decel_snap;
+            }
+        }
+
         #if 0
         THEKERNEL->streams->printf("spt: %08lX %08lX, ac: %08lX %08lX, dc: %08lX %08lX, pr: %08lX %08lX\n",
             (uint32_t)(this->tick_info[m].steps_per_tick>>32), // 2.62 fixed point
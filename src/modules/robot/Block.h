@@ -14,7 +14,7 @@ class Block {
     public:
         Block();
 
-        static void init(uint8_t);
+        static void init(uint8_t, bool);
 
         void calculate_trapezoid( float entry_speed, float exit_speed );
 
@@ -25,6 +25,10 @@ class Block {
         void ready() { is_ready= true; }
         void clear();
         float get_trapezoid_rate(int i) const;
+        // an s-curve ramp peaks at 1.5 times its average acceleration, so its ramps are planned at 2/3 of the
+        // configured acceleration to keep the peak within it
+        float ramp_acceleration() const { return ramp_acceleration(acceleration, is_s_curve); }
+        static float ramp_acceleration(float acceleration, bool s_curve) { return s_curve ? acceleration * (2.0F / 3.0F) : acceleration; }
 
     private:
         float max_allowable_speed( float acceleration, float target_velocity, float distance);
@@ -67,7 +71,16 @@ class Block {
         // need info for each active motor
         tickinfo_t *tick_info;
 
+        // the extra terms of the s-curve ramps, only allocated when s_curve_acceleration is on
+        using s_curve_info_t= struct {
+            int64_t jerk; // 2.62 fixed point signed, change in acceleration_change per tick on s-curve ramps
+            int64_t snap; // 2.62 fixed point signed, change in jerk per tick on s-curve ramps
+            int64_t decel_snap; // 2.62 fixed point signed, snap for the deceleration ramp, its jerk is set when it starts
+        };
+        s_curve_info_t *s_curve_info;
+
         static uint8_t n_actuators;
+        static bool s_curve;
 
         struct {
             bool recalculate_flag:1;             // Planner flag to recalculate trapezoids on entry junction
@@ -77,6 +90,7 @@ class Block {
             bool is_g123:1;                      // set if this is a G1, G2 or G3
             volatile bool is_ticking:1;          // set when this block is being actively ticked by the stepticker
             volatile bool locked:1;              // set to true when the critical data is being updated, stepticker will have to skip if this is set
+            bool is_s_curve:1;                   // set if the acceleration ramps use the jerk limited s-curve profile
             uint16_t s_value:12;                 // for laser 1.11 Fixed point
         };
 };
@@ -141,6 +141,15 @@ bool BlockQueue::is_full() const
     return r;
 }
 
+// one item is always left empty to tell a full queue from an empty one
+unsigned int BlockQueue::free_items() const
+{
+    if (length == 0)
+        return 0;
+
+    return (tail_i + length - head_i - 1) % length;
+}
+
 bool BlockQueue::is_empty() const
 {
     //__disable_irq();
@@ -22,6 +22,7 @@
 #include "StepTicker.h"
 #include "Robot.h"
 #include "StepperMotor.h"
+#include "IsrProfile.h"
 
 #include <functional>
 
@@ -78,7 +79,7 @@ void Conveyor::on_module_loaded()
 // we allocate the queue here after config is completed so we do not run out of memory during config
 void Conveyor::start(uint8_t n)
 {
-    Block::init(n); // set the number of motors which determines how big the tick info vector is
+    Block::init(n, THEKERNEL->planner->is_s_curve()); // set the number of motors which determines how big the tick info vector is
     queue.resize(queue_size);
     running = true;
 }
@@ -91,8 +92,12 @@ void Conveyor::on_halt(void *argument)
     }
 }
 
+ISR_PROFILE_DEFINE(conveyor_idle_profile, "conveyor on_idle");
+
 void Conveyor::on_idle(void *)
 {
+    ISR_PROFILE_SCOPE(conveyor_idle_profile);
+
     if (running)
     {
         check_queue();
@@ -237,7 +242,6 @@ bool Conveyor::get_next_block(Block **block)
             __debugbreak(); // should never happen
 
         b->is_ticking = true;
-        b->recalculate_flag = false;
         this->current_feedrate = b->nominal_speed;
         *block = b;
         return true;
@@ -25,6 +25,7 @@ public:
     void wait_for_idle(bool wait_for_motors=true);
     bool is_queue_empty() { return queue.is_empty(); };
     bool is_queue_full() { return queue.is_full(); };
+    size_t get_queue_free() const { return queue.free_items(); }
     bool is_idle() const;
 
     // returns next available block writes it to block and returns true
@@ -35,6 +36,7 @@ public:
     void flush_queue(void);
     float get_current_feedrate() const { return current_feedrate; }
     void force_queue() { check_queue(true); }
+    size_t get_queue_size() const { return queue_size; }
 
     friend class Planner; // for queue
 
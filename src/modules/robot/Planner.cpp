@@ -28,14 +28,31 @@ using namespace std;
 #define junction_deviation_checksum    CHECKSUM("junction_deviation")
 #define z_junction_deviation_checksum  CHECKSUM("z_junction_deviation")
 #define minimum_planner_speed_checksum CHECKSUM("minimum_planner_speed")
+#define coalesce_tolerance_checksum    CHECKSUM("coalesce_tolerance")
+#define s_curve_acceleration_checksum  CHECKSUM("s_curve_acceleration")
+
+#ifdef PLANNER_SIM
+// timing hooks for the host simulation in src/testframework/host, only defined in its Makefile
+extern void planner_sim_recalculate_begin();
+extern void planner_sim_recalculate_end();
+extern void planner_sim_recalculate_coalesced();
+#define PLANNER_SIM_HOOK(x) planner_sim_recalculate_##x()
+#else
+#define PLANNER_SIM_HOOK(x)
+#endif
 
 // The Planner does the acceleration math for the queue of Blocks ( movements ).
 // It makes sure the speed stays within the configured constraints ( acceleration, junction_deviation, etc )
 // It goes over the list in both direction, every time a block is added, re-doing the math to make sure everything is optimal
+// Only the blocks after the last one that can no longer be improved on (planned_i) are gone over, as in Grbl
 
 Planner::Planner()
 {
     memset(this->previous_unit_vec, 0, sizeof this->previous_unit_vec);
+    memset(this->coalesce_chord, 0, sizeof this->coalesce_chord);
+    planned_i = 0;
+    coalesce_error = NAN;
+    coalesce_step_error = 0;
     config_load();
 }
 
@@ -45,6 +62,8 @@ void Planner::config_load()
     this->junction_deviation = THEKERNEL->config->value(junction_deviation_checksum)->by_default(0.05F)->as_number();
     this->z_junction_deviation = THEKERNEL->config->value(z_junction_deviation_checksum)->by_default(NAN)->as_number(); // disabled by default
     this->minimum_planner_speed = THEKERNEL->config->value(minimum_planner_speed_checksum)->by_default(0.0f)->as_number();
+    this->coalesce_tolerance = THEKERNEL->config->value(coalesce_tolerance_checksum)->by_default(0.0f)->as_number(); // disabled by default
+    this->s_curve_acceleration = THEKERNEL->config->value(s_curve_acceleration_checksum)->by_default(false)->as_bool();
 }
 
 
@@ -73,6 +92,13 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     // sometimes even though there is a detectable movement it turns out there are no steps to be had from such a small move
     if(!has_steps) {
         block->clear();
+        // it still moves the end of a run of coalesced moves, by less than a step
+        if (unit_vec != nullptr && !isnan(coalesce_error)) {
+            for (int i = 0; i < N_PRIMARY_AXIS; ++i) {
+                coalesce_chord[i] += unit_vec[i] * distance;
+            }
+            coalesce_error += distance;
+        }
         // we still return true so the tiny move will still be accumulated and eventually create steps
         return true;
     }
@@ -80,6 +106,7 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     // info needed by laser
     block->s_value = roundf(s_value*(1<<11)); // 1.11 fixed point
     block->is_g123 = g123;
+    block->is_s_curve = s_curve_acceleration;
 
     // use default JD
     float junction_deviation = this->junction_deviation;
@@ -173,8 +200,14 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     }
     block->max_entry_speed = vmax_junction;
 
+    // a tiny move that just continues the last one can extend it instead of taking a block of its own
+    if (coalesce(block, distance, unit_vec)) {
+        block->clear();
+        return true;
+    }
+
     // Initialize block entry speed. Compute based on deceleration to user-defined minimum_planner_speed.
-    float v_allowable = max_allowable_speed(-acceleration, minimum_planner_speed, block->millimeters);
+    float v_allowable = max_allowable_speed(-block->ramp_acceleration(), minimum_planner_speed, block->millimeters);
     block->entry_speed = std::min(vmax_junction, v_allowable);
 
     // Initialize planner efficiency flags
@@ -194,12 +227,22 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     // Update previous path unit_vector and nominal speed
     if(unit_vec != nullptr) {
         memcpy(previous_unit_vec, unit_vec, sizeof(previous_unit_vec)); // previous_unit_vec[] = unit_vec[]
+
+        // start a new run of moves that following ones may be coalesced into
+        for (int i = 0; i < N_PRIMARY_AXIS; ++i) {
+            coalesce_chord[i] = unit_vec[i] * distance;
+        }
+        coalesce_error = 0;
+        coalesce_step_error = 0;
     } else {
         memset(previous_unit_vec, 0, sizeof(previous_unit_vec));
+        coalesce_error = NAN;
     }
 
     // Math-heavy re-computing of the whole queue to take the new
-    this->recalculate();
+    PLANNER_SIM_HOOK(begin);
+    this->recalculate(THECONVEYOR->queue.head_i);
+    PLANNER_SIM_HOOK(end);
 
     // The block can now be used
     block->ready();
@@ -209,7 +252,110 @@ bool Planner::append_block( ActuatorCoordinates &actuator_pos, uint8_t n_motors,
     return true;
 }
 
-void Planner::recalculate()
+// Coalesce the move in block into the last block in the queue if the path stays within coalesce_tolerance of the
+// straight line the merged block will take, returns true if it did and block is not needed.
+// The last block must not have started, and the junction must be one the planner would not slow down for.
+// Actuators that are not primary axes (eg extruders) must stay within a step of where they were at the junction.
+bool Planner::coalesce(Block *block, float distance, const float *unit_vec)
+{
+    Conveyor::Queue_t &queue = THECONVEYOR->queue;
+
+    if (coalesce_tolerance <= 0.0F || unit_vec == nullptr || isnan(coalesce_error) || queue.is_empty())
+        return false;
+
+    unsigned int last_i = queue.prev(queue.head_i);
+    Block *last = queue.item_ref(last_i);
+
+    // nothing that slows down at the junction, or changes the laser power, can be merged.
+    // The speed and acceleration may differ slightly as the axis limits depend on the direction, the lower ones are used
+    float nominal_speed = std::min(block->nominal_speed, last->nominal_speed);
+    float acceleration = std::min(block->acceleration, last->acceleration);
+    if (block->max_entry_speed < nominal_speed || block->s_value != last->s_value || block->is_g123 != last->is_g123 ||
+        fabsf(block->nominal_speed - last->nominal_speed) > 0.01F * nominal_speed ||
+        fabsf(block->acceleration - last->acceleration) > 0.01F * acceleration) {
+        return false;
+    }
+
+    // how far the end of the last block is from the line to the end of this one
+    float chord[N_PRIMARY_AXIS];
+    float sos = 0;
+    for (int i = 0; i < N_PRIMARY_AXIS; ++i) {
+        chord[i] = coalesce_chord[i] + unit_vec[i] * distance;
+        sos += chord[i] * chord[i];
+    }
+    float millimeters = sqrtf(sos);
+
+    float along = 0, last_sos = 0;
+    for (int i = 0; i < N_PRIMARY_AXIS; ++i) {
+        along += coalesce_chord[i] * chord[i];
+        last_sos += coalesce_chord[i] * coalesce_chord[i];
+    }
+    along /= millimeters;
+    float deviation = sqrtf(std::max(0.0F, last_sos - along * along));
+    if (coalesce_error + deviation > coalesce_tolerance)
+        return false;
+
+    // all actuators must keep going the same way, and the others must stay within a step of the path
+    float step_error = 0;
+    float ratio = sqrtf(last_sos) / millimeters;
+    for (size_t i = 0; i < Block::n_actuators; i++) {
+        if (block->steps[i] != 0 && last->steps[i] != 0 && block->direction_bits[i] != last->direction_bits[i])
+            return false;
+        if (i >= N_PRIMARY_AXIS) {
+            step_error = std::max(step_error, fabsf((last->steps[i] + block->steps[i]) * ratio - last->steps[i]));
+        }
+    }
+    if (coalesce_step_error + step_error >= 1.0F)
+        return false;
+
+    // the entry speed the previous block is planned to exit at must still be possible
+    float v_allowable = max_allowable_speed(-Block::ramp_acceleration(acceleration, last->is_s_curve), minimum_planner_speed, millimeters);
+    if (last->entry_speed > nominal_speed || last->entry_speed > v_allowable)
+        return false;
+
+    // stop the step ticker taking the last block while we change it, if it already has we are too late
+    last->locked = true;
+    if (last->is_ticking) {
+        last->locked = false;
+        return false;
+    }
+
+    for (size_t i = 0; i < Block::n_actuators; i++) {
+        if (last->steps[i] == 0) last->direction_bits[i] = block->direction_bits[i];
+        last->steps[i] += block->steps[i];
+    }
+    last->steps_event_count = *std::max_element(last->steps.begin(), last->steps.end());
+    last->millimeters = millimeters;
+    last->nominal_speed = nominal_speed;
+    last->nominal_rate = last->steps_event_count * nominal_speed / millimeters;
+    last->acceleration = acceleration;
+    last->max_entry_speed = std::min(last->max_entry_speed, nominal_speed);
+    last->nominal_length_flag = (nominal_speed <= v_allowable);
+    last->recalculate_flag = true;
+
+    // its entry speed may now be improved on
+    if (planned_i == last_i) planned_i = queue.prev(last_i);
+
+    // make it a complete block stopping at the end before the step ticker can see it again
+    last->calculate_trapezoid(last->entry_speed, minimum_planner_speed);
+
+    memcpy(coalesce_chord, chord, sizeof(coalesce_chord));
+    coalesce_error += deviation;
+    coalesce_step_error += step_error;
+    for (int i = 0; i < N_PRIMARY_AXIS; ++i) {
+        previous_unit_vec[i] = chord[i] / millimeters;
+    }
+
+    PLANNER_SIM_HOOK(begin);
+    recalculate(last_i);
+    PLANNER_SIM_HOOK(end);
+    PLANNER_SIM_HOOK(coalesced);
+
+    return true;
+}
+
+// Replan the queue up to and including the newest block at newest_i
+void Planner::recalculate(unsigned int newest_i)
 {
     Conveyor::Queue_t &queue = THECONVEYOR->queue;
 
@@ -247,15 +393,22 @@ void Planner::recalculate()
     /*
      * Step 1:
      * For each block, given the exit speed and acceleration, find the maximum entry speed
+     *
+     * planned_i is the last block that cannot be improved on by adding more blocks, either because it is
+     * acceleration limited or already at its max entry speed, so neither it nor anything before it needs looking at again.
+     * The step ticker may have moved past it, so we also stop at a block that has started ticking or the tail.
+     * If the head has come around to it then it was consumed long ago and the tail is the limit.
      */
 
     float entry_speed = minimum_planner_speed;
 
-    block_index = queue.head_i;
+    block_index = newest_i;
     current     = queue.item_ref(block_index);
 
-    if (!queue.is_empty()) {
-        while ((block_index != queue.tail_i) && current->recalculate_flag) {
+    if (planned_i == queue.head_i) planned_i = queue.tail_i;
+
+    if (newest_i != queue.tail_i) {
+        while (block_index != planned_i && block_index != queue.tail_i && !current->is_ticking) {
             entry_speed = current->reverse_pass(entry_speed);
 
             block_index = queue.prev(block_index);
@@ -264,7 +417,7 @@ void Planner::recalculate()
 
         /*
          * Step 2:
-         * now current points to either tail or first non-recalculate block
+         * now current points to the planned block, the ticking block or the tail
          * and has not had its reverse_pass called
          * or its calculate_trapezoid
          * entry_speed is set to the *exit* speed of current.
@@ -273,7 +426,7 @@ void Planner::recalculate()
 
         float exit_speed = current->max_exit_speed();
 
-        while (block_index != queue.head_i) {
+        while (block_index != newest_i) {
             previous    = current;
             block_index = queue.next(block_index);
             current     = queue.item_ref(block_index);
@@ -282,6 +435,9 @@ void Planner::recalculate()
             // so this block can decide if it's accel or decel limited and update its fields as appropriate
             exit_speed = current->forward_pass(exit_speed);
 
+            // an accel limited block, or one at its max entry speed, is optimal and so is everything before it
+            if (!current->recalculate_flag) planned_i = block_index;
+
             previous->calculate_trapezoid(previous->entry_speed, current->entry_speed);
         }
     }
@@ -291,7 +447,7 @@ void Planner::recalculate()
      * work out trapezoid for final (and newest) block
      */
 
-    // now current points to the head item
+    // now current points to the newest item
     // which has not had calculate_trapezoid run yet
     current->calculate_trapezoid(current->entry_speed, minimum_planner_speed);
 }
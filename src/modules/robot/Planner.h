@@ -16,17 +16,27 @@ class Planner
 public:
     Planner();
     float max_allowable_speed( float acceleration, float target_velocity, float distance);
+    bool is_s_curve() const { return s_curve_acceleration; }
 
     friend class Robot; // for acceleration, junction deviation, minimum_planner_speed
 
 private:
     bool append_block(ActuatorCoordinates &target, uint8_t n_motors, float rate_mm_s, float distance, float unit_vec[], float accleration, float s_value, bool g123);
-    void recalculate();
+    bool coalesce(Block *block, float distance, const float *unit_vec);
+    void recalculate(unsigned int newest_i);
     void config_load();
     float previous_unit_vec[N_PRIMARY_AXIS];
     float junction_deviation;    // Setting
     float z_junction_deviation;  // Setting
     float minimum_planner_speed; // Setting
+    float coalesce_tolerance;    // Setting
+    bool s_curve_acceleration;   // Setting
+    unsigned int planned_i;      // queue index of the last block that can no longer be improved on
+
+    // the run of moves coalesced into the last block so far
+    float coalesce_chord[N_PRIMARY_AXIS];
+    float coalesce_error;        // how far off the straight line they can be, NAN if nothing can be coalesced
+    float coalesce_step_error;   // for actuators that are not primary axis, in steps
 };
 
 
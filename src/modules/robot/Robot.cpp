@@ -100,6 +100,9 @@
 
 #define PI 3.14159265358979323846F // force to be float, do not use M_PI
 
+// how many segments of a line append_line() transforms at a time
+#define segment_batch_size 8
+
 //#define DEBUG_PRINTF THEKERNEL->streams->printf
 #define DEBUG_PRINTF(...)
 
@@ -126,6 +129,7 @@ Robot::Robot()
     this->next_command_is_MCS = false;
     this->disable_segmentation = false;
     this->disable_arm_solution = false;
+    this->use_workpiece_offset = false;
     this->n_motors = 0;
 }
 
@@ -156,6 +160,10 @@ void Robot::load_config()
     // Here we read the config to find out which arm solution to use
     if (this->arm_solution)
         delete this->arm_solution;
+#ifdef FIXED_ARM_SOLUTION
+    // chosen at build time with ARM_SOLUTION=<class>, the arm_solution setting is ignored
+    this->arm_solution = new FIXED_ARM_SOLUTION(THEKERNEL->config);
+#else
     int solution_checksum = get_checksum(THEKERNEL->config->value(arm_solution_checksum)->by_default("cartesian")->as_string());
     // Note checksums are not const expressions when in debug mode, so don't use switch
     if (solution_checksum == hbot_checksum || solution_checksum == corexy_checksum)
@@ -190,6 +198,7 @@ void Robot::load_config()
     {
         this->arm_solution = new CartesianSolution(THEKERNEL->config);
     }
+#endif
 
     this->feed_rate = THEKERNEL->config->value(default_feed_rate_checksum)->by_default(100.0F)->as_number();
     this->seek_rate = THEKERNEL->config->value(default_seek_rate_checksum)->by_default(100.0F)->as_number();
@@ -241,8 +250,8 @@ void Robot::load_config()
     // default acceleration setting, can be overriden with newer per axis settings
     this->default_acceleration = THEKERNEL->config->value(acceleration_checksum)->by_default(100.0F)->as_number(); // Acceleration is in mm/s^2
 
-    // make each motor
-    for (size_t a = 0; a < MAX_ROBOT_ACTUATORS; a++)
+    // make each motor, any actuators after ABC are extruders and are created by the extruder module
+    for (size_t a = 0; a < sizeof(motor_checksums) / sizeof(motor_checksums[0]); a++)
     {
         Pin pins[3]; //step, dir, enable
         for (size_t i = 0; i < 3; i++)
@@ -1638,26 +1647,66 @@ void Robot::calculate_workpiece_offset(const float target[])
 // all transforms and is what we actually convert to actuator positions
 bool Robot::append_milestone(const float target[], float rate_mm_s)
 {
-    float deltas[n_motors];
     float transformed_target[n_motors]; // adjust target for bed compensation
-    float unit_vec[N_PRIMARY_AXIS];
+    ActuatorCoordinates actuator_pos;
+
+    transform_milestones(target, transformed_target, &actuator_pos, 1);
+    return append_transformed_milestone(transformed_target, actuator_pos, rate_mm_s);
+}
 
+// Apply babysteps, the compensation transform and the arm solution to n targets of n_motors floats each
+// the babysteps only go on the first one
+void Robot::transform_milestones(const float targets[], float transformed_targets[], ActuatorCoordinates actuator_pos[], size_t n)
+{
     // unity transform by default
-    memcpy(transformed_target, target, n_motors * sizeof(float));
+    memcpy(transformed_targets, targets, n * n_motors * sizeof(float));
 
     // apply babysteps
     for (int i = 0; i < n_motors; ++i)
     {
-        transformed_target[i] += babysteps[i];
+        transformed_targets[i] += babysteps[i];
         babysteps[i] = 0;
     }
 
     // check function pointer and call if set to transform the target to compensate for bed
     if (compensationTransform)
     {
-        // some compensation strategies can transform XYZ, some just change Z
-        compensationTransform(transformed_target, false);
+        for (size_t k = 0; k < n; ++k)
+        {
+            // some compensation strategies can transform XYZ, some just change Z
+            compensationTransform(&transformed_targets[k * n_motors], false);
+        }
+    }
+
+    // find actuator position given the machine position, use actual adjusted target
+    if (!disable_arm_solution)
+    {
+#ifdef FIXED_ARM_SOLUTION
+        // a qualified call is not virtual so the simple arm solutions inline here
+        for (size_t k = 0; k < n; ++k)
+            static_cast<FIXED_ARM_SOLUTION *>(arm_solution)->FIXED_ARM_SOLUTION::cartesian_to_actuator(&transformed_targets[k * n_motors], actuator_pos[k]);
+#else
+        arm_solution->cartesian_to_actuator_batch(transformed_targets, n_motors, actuator_pos, n);
+#endif
     }
+    else
+    {
+        // basically the same as cartesian, would be used for special homing situations like for scara
+        for (size_t k = 0; k < n; ++k)
+        {
+            for (size_t i = X_AXIS; i <= Z_AXIS; i++)
+            {
+                actuator_pos[k][i] = transformed_targets[k * n_motors + i];
+            }
+        }
+    }
+}
+
+// Append a target that transform_milestones() has already converted to actuator positions
+bool Robot::append_transformed_milestone(const float transformed_target[], ActuatorCoordinates &actuator_pos, float rate_mm_s)
+{
+    float deltas[n_motors];
+    float unit_vec[N_PRIMARY_AXIS];
 
     // check soft endstops only for homed axis that are enabled
     if (soft_endstop_enabled)
@@ -1768,21 +1817,6 @@ bool Robot::append_milestone(const float target[], float rate_mm_s)
         }
     }
 
-    // find actuator position given the machine position, use actual adjusted target
-    ActuatorCoordinates actuator_pos;
-    if (!disable_arm_solution)
-    {
-        arm_solution->cartesian_to_actuator(transformed_target, actuator_pos);
-    }
-    else
-    {
-        // basically the same as cartesian, would be used for special homing situations like for scara
-        for (size_t i = X_AXIS; i <= Z_AXIS; i++)
-        {
-            actuator_pos[i] = transformed_target[i];
-        }
-    }
-
 #if MAX_ROBOT_ACTUATORS > 3
     sos = 0;
     // for the extruders just copy the position, and possibly scale it from mm³ to mm
@@ -1983,19 +2017,36 @@ bool Robot::append_line(Gcode *gcode, const float target[], float rate_mm_s, flo
         for (int i = 0; i < n_motors; i++)
             segment_delta[i] = (target[i] - machine_position[i]) / segments;
 
+        // the segment ends are transformed a batch at a time, then appended one by one
+        float batch_targets[segment_batch_size * n_motors];
+        float batch_transformed[segment_batch_size * n_motors];
+        ActuatorCoordinates batch_actuator_pos[segment_batch_size];
+
         // segment 0 is already done - it's the end point of the previous move so we start at segment 1
         // We always add another point after this loop so we stop at segments-1, ie i < segments
-        for (int i = 1; i < segments; i++)
+        for (int i = 1; i < segments; i += segment_batch_size)
         {
-            if (THEKERNEL->is_halted())
-                return false; // don't queue any more segments
-            for (int j = 0; j < n_motors; j++)
-                segment_end[j] += segment_delta[j];
+            size_t n = min(segments - i, (int)segment_batch_size);
+            for (size_t k = 0; k < n; k++)
+            {
+                for (int j = 0; j < n_motors; j++)
+                {
+                    segment_end[j] += segment_delta[j];
+                    batch_targets[k * n_motors + j] = segment_end[j];
+                }
+            }
+            transform_milestones(batch_targets, batch_transformed, batch_actuator_pos, n);
 
-            // Append the end of this segment to the queue
-            // this can block waiting for free block queue or if in feed hold
-            bool b = this->append_milestone(segment_end, rate_mm_s);
-            moved = moved || b;
+            for (size_t k = 0; k < n; k++)
+            {
+                if (THEKERNEL->is_halted())
+                    return false; // don't queue any more segments
+
+                // Append the end of this segment to the queue
+                // this can block waiting for free block queue or if in feed hold
+                bool b = this->append_transformed_milestone(&batch_transformed[k * n_motors], batch_actuator_pos[k], rate_mm_s);
+                moved = moved || b;
+            }
         }
     }
 
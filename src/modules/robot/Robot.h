@@ -111,6 +111,8 @@ private:
 
     void load_config();
     bool append_milestone(const float target[], float rate_mm_s);
+    void transform_milestones(const float targets[], float transformed_targets[], ActuatorCoordinates actuator_pos[], size_t n);
+    bool append_transformed_milestone(const float transformed_target[], ActuatorCoordinates &actuator_pos, float rate_mm_s);
     bool append_line(Gcode *gcode, const float target[], float rate_mm_s, float delta_e);
     bool append_arc(Gcode *gcode, const float target[], const float offset[], float radius, bool is_clockwise, float delta_e);
     bool compute_arc(Gcode *gcode, const float offset[], const float target[], enum MOTION_MODE_T motion_mode, float delta_e);
@@ -1,4 +1,6 @@
 // Base class for an arm solution, only usefull for inheritence. http://en.wikipedia.org/wiki/Arm_solution
+// When the firmware is built with ARM_SOLUTION=<class> Robot calls that class directly instead of through this interface,
+// the simple solutions define cartesian_to_actuator() in their header so it can then be inlined.
 #ifndef BASESOLUTION_H
 #define BASESOLUTION_H
 
@@ -14,6 +16,13 @@ class BaseSolution {
         virtual ~BaseSolution() {};
         virtual void cartesian_to_actuator(const float[], ActuatorCoordinates &) const = 0;
         virtual void actuator_to_cartesian(const ActuatorCoordinates &, float[]) const = 0;
+        // converts n positions that are stride floats apart, solutions can override it to do their setup once per batch
+        virtual void cartesian_to_actuator_batch(const float cartesian_mm[], size_t stride, ActuatorCoordinates actuator_mm[], size_t n) const
+        {
+            for (size_t i = 0; i < n; i++) {
+                cartesian_to_actuator(&cartesian_mm[i * stride], actuator_mm[i]);
+            }
+        }
         typedef std::map<char, float> arm_options_t;
         virtual bool set_optional(const arm_options_t& options) { return false; };
         virtual bool get_optional(arm_options_t& options, bool force_all= false) const { return false; };
@@ -11,6 +11,10 @@ class CartesianSolution : public BaseSolution {
     public:
         CartesianSolution(){};
         CartesianSolution(Config*){};
-        void cartesian_to_actuator( const float millimeters[], ActuatorCoordinates &steps ) const override;
+        void cartesian_to_actuator( const float cartesian_mm[], ActuatorCoordinates &actuator_mm ) const override {
+            actuator_mm[ALPHA_STEPPER] = cartesian_mm[X_AXIS];
+            actuator_mm[BETA_STEPPER ] = cartesian_mm[Y_AXIS];
+            actuator_mm[GAMMA_STEPPER] = cartesian_mm[Z_AXIS];
+        }
         void actuator_to_cartesian( const ActuatorCoordinates &steps, float millimeters[] ) const override;
 };
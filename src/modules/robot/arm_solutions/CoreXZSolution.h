@@ -10,7 +10,11 @@
 class CoreXZSolution : public BaseSolution {
     public:
         CoreXZSolution(Config*);
-        void cartesian_to_actuator(const float[], ActuatorCoordinates & ) const override;
+        void cartesian_to_actuator(const float cartesian_mm[], ActuatorCoordinates &actuator_mm ) const override {
+            actuator_mm[ALPHA_STEPPER] = (this->x_reduction * cartesian_mm[X_AXIS]) + (this->z_reduction * cartesian_mm[Z_AXIS]);
+            actuator_mm[BETA_STEPPER ] = (this->x_reduction * cartesian_mm[X_AXIS]) - (this->z_reduction * cartesian_mm[Z_AXIS]);
+            actuator_mm[GAMMA_STEPPER] = cartesian_mm[Y_AXIS];
+        }
         void actuator_to_cartesian(const ActuatorCoordinates &, float[] ) const override;
 
     private:
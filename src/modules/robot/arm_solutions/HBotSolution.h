@@ -11,6 +11,11 @@ class HBotSolution : public BaseSolution {
     public:
         HBotSolution();
         HBotSolution(Config*){};
-        void cartesian_to_actuator(const float[], ActuatorCoordinates &) const override;
+        void cartesian_to_actuator(const float cartesian_mm[], ActuatorCoordinates &actuator_mm) const override
+        {
+            actuator_mm[ALPHA_STEPPER] = cartesian_mm[X_AXIS] + cartesian_mm[Y_AXIS];
+            actuator_mm[BETA_STEPPER ] = cartesian_mm[X_AXIS] - cartesian_mm[Y_AXIS];
+            actuator_mm[GAMMA_STEPPER] = cartesian_mm[Z_AXIS];
+        }
         void actuator_to_cartesian(const ActuatorCoordinates &, float[]) const override;
 };
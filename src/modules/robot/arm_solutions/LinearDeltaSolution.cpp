@@ -73,6 +73,23 @@ void LinearDeltaSolution::cartesian_to_actuator(const float cartesian_mm[], Actu
                                       ) + cartesian_mm[Z_AXIS];
 }
 
+// same as cartesian_to_actuator() with the tower positions held in registers for the whole batch
+void LinearDeltaSolution::cartesian_to_actuator_batch(const float cartesian_mm[], size_t stride, ActuatorCoordinates actuator_mm[], size_t n) const
+{
+    const float l2 = this->arm_length_squared;
+    const float t1x = delta_tower1_x, t1y = delta_tower1_y;
+    const float t2x = delta_tower2_x, t2y = delta_tower2_y;
+    const float t3x = delta_tower3_x, t3y = delta_tower3_y;
+
+    for (size_t i = 0; i < n; i++) {
+        const float *c = &cartesian_mm[i * stride];
+        float x = c[X_AXIS], y = c[Y_AXIS], z = c[Z_AXIS];
+        actuator_mm[i][ALPHA_STEPPER] = sqrtf(l2 - SQ(t1x - x) - SQ(t1y - y)) + z;
+        actuator_mm[i][BETA_STEPPER ] = sqrtf(l2 - SQ(t2x - x) - SQ(t2y - y)) + z;
+        actuator_mm[i][GAMMA_STEPPER] = sqrtf(l2 - SQ(t3x - x) - SQ(t3y - y)) + z;
+    }
+}
+
 void LinearDeltaSolution::actuator_to_cartesian(const ActuatorCoordinates &actuator_mm, float cartesian_mm[] ) const
 {
     // from http://en.wikipedia.org/wiki/Circumscribed_circle#Barycentric_coordinates_from_cross-_and_dot-products
@@ -14,19 +14,7 @@ RotatableCartesianSolution::RotatableCartesianSolution(Config* config)
     cos_alpha          = cosf(alpha_angle);
 }
 
-void RotatableCartesianSolution::cartesian_to_actuator(const float cartesian_mm[], ActuatorCoordinates &actuator_mm ) const
-{
-    rotate( cartesian_mm, &actuator_mm[0], sin_alpha, cos_alpha );
-}
-
 void RotatableCartesianSolution::actuator_to_cartesian(const ActuatorCoordinates &actuator_mm, float cartesian_mm[] ) const
 {
     rotate( &actuator_mm[0], cartesian_mm, - sin_alpha, cos_alpha );
 }
-
-void RotatableCartesianSolution::rotate(const float in[], float out[], float sin, float cos ) const
-{
-    out[ALPHA_STEPPER] = cos * in[X_AXIS] - sin * in[Y_AXIS];
-    out[BETA_STEPPER ] = sin * in[X_AXIS] + cos * in[Y_AXIS];
-    out[GAMMA_STEPPER] =       in[Z_AXIS];
-}
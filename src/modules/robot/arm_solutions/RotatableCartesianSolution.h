@@ -12,11 +12,19 @@
 class RotatableCartesianSolution : public BaseSolution {
     public:
         RotatableCartesianSolution(Config*);
-        void cartesian_to_actuator(const float[], ActuatorCoordinates &) const override;
+        void cartesian_to_actuator(const float cartesian_mm[], ActuatorCoordinates &actuator_mm ) const override
+        {
+            rotate( cartesian_mm, &actuator_mm[0], sin_alpha, cos_alpha );
+        }
         void actuator_to_cartesian(const ActuatorCoordinates &, float[] ) const override;
 
     private:
-        void rotate(const float in[], float out[], float sin, float cos) const;
+        void rotate(const float in[], float out[], float sin, float cos) const
+        {
+            out[ALPHA_STEPPER] = cos * in[X_AXIS] - sin * in[Y_AXIS];
+            out[BETA_STEPPER ] = sin * in[X_AXIS] + cos * in[Y_AXIS];
+            out[GAMMA_STEPPER] =       in[Z_AXIS];
+        }
 
         float sin_alpha;
         float cos_alpha;
@@ -30,6 +30,8 @@
 #include "BaseSolution.h"
 #include "SerialMessage.h"
 
+#include "InterruptIn.h" // mbed
+
 #include <ctype.h>
 #include <algorithm>
 
@@ -74,6 +76,7 @@ enum DEFNS
 
 #define endstop_debounce_count_checksum CHECKSUM("endstop_debounce_count")
 #define endstop_debounce_ms_checksum CHECKSUM("endstop_debounce_ms")
+#define endstop_interrupt_checksum CHECKSUM("endstop_interrupt")
 
 #define home_z_first_checksum CHECKSUM("home_z_first")
 #define homing_order_checksum CHECKSUM("homing_order")
@@ -147,6 +150,26 @@ void Endstops::on_module_loaded()
     register_for_event(ON_GET_PUBLIC_DATA);
     register_for_event(ON_SET_PUBLIC_DATA);
 
+    // homing endstops on ports 0 and 2 can stop the motors from the pin interrupt, the others are still polled
+    this->has_endstop_irq = false;
+    if (this->endstop_interrupt)
+    {
+        for (auto &e : homing_axis)
+        {
+            if (e.pin_info == nullptr)
+                continue;
+            Pin &pin = e.pin_info->pin;
+            if (pin.port_number == 0 || pin.port_number == 2)
+            {
+                // endstops may be NO or NC so take both edges and check the level in the handler
+                mbed::InterruptIn *irq = pin.interrupt_pin(true);
+                irq->rise(this, &Endstops::on_endstop_edge);
+                irq->fall(this, &Endstops::on_endstop_edge);
+                this->has_endstop_irq = true;
+            }
+        }
+    }
+
     THEKERNEL->slow_ticker->attach(1000, this, &Endstops::read_endstops);
 }
 
@@ -208,6 +231,7 @@ bool Endstops::load_old_config()
 
             // init struct
             info->debounce = 0;
+            info->latched = false;
             info->axis = 'X' + i;
             info->axis_index = i;
 
@@ -331,6 +355,7 @@ bool Endstops::load_config()
 
         // init pin struct
         pin_info->debounce = 0;
+        pin_info->latched = false;
         pin_info->axis = toupper(axis[0]);
         pin_info->axis_index = i;
 
@@ -434,6 +459,9 @@ void Endstops::get_global_configs()
     this->debounce_ms = THEKERNEL->config->value(endstop_debounce_ms_checksum)->by_default(0)->as_number();
     this->debounce_count = THEKERNEL->config->value(endstop_debounce_count_checksum)->by_default(100)->as_number();
 
+    // trigger on the pin edge and latch the step count there, endstop_debounce_ms then becomes a confirmation window
+    this->endstop_interrupt = THEKERNEL->config->value(endstop_interrupt_checksum)->by_default(false)->as_bool();
+
     this->is_corexy = THEKERNEL->config->value(corexy_homing_checksum)->by_default(false)->as_bool();
     this->is_delta = THEKERNEL->config->value(delta_homing_checksum)->by_default(false)->as_bool();
     this->is_rdelta = THEKERNEL->config->value(rdelta_homing_checksum)->by_default(false)->as_bool();
@@ -652,6 +680,10 @@ uint32_t Endstops::read_endstops(uint32_t dummy)
     if (this->status != MOVING_TO_ENDSTOP_SLOW && this->status != MOVING_TO_ENDSTOP_FAST)
         return 0; // not doing anything we need to monitor for
 
+    // the edge interrupt also latches and stops the motors
+    if (has_endstop_irq)
+        NVIC_DisableIRQ(EINT3_IRQn);
+
     // check each homing endstop
     for (auto &e : homing_axis)
     { // check all axis homing endstops
@@ -668,23 +700,20 @@ uint32_t Endstops::read_endstops(uint32_t dummy)
             // if it is moving then we check the associated endstop, and debounce it
             if (e.pin_info->pin.get())
             {
+                // an edge can be missed while the switch bounces, so this latches it as a fallback
+                if (endstop_interrupt && !e.pin_info->latched)
+                {
+                    latch_axis(m);
+                    e.pin_info->latched = true;
+                }
+
                 if (e.pin_info->debounce < debounce_ms)
                 {
                     e.pin_info->debounce++;
                 }
                 else
                 {
-                    if (is_corexy && (m == X_AXIS || m == Y_AXIS))
-                    {
-                        // corexy when moving in X or Y we need to stop both the X and Y motors
-                        STEPPER[X_AXIS]->stop_moving();
-                        STEPPER[Y_AXIS]->stop_moving();
-                    }
-                    else
-                    {
-                        // we signal the motor to stop, which will preempt any moves on that axis
-                        STEPPER[m]->stop_moving();
-                    }
+                    stop_axis(m);
                     e.pin_info->triggered = true;
                 }
             }
@@ -692,13 +721,120 @@ uint32_t Endstops::read_endstops(uint32_t dummy)
             {
                 // The endstop was not hit yet
                 e.pin_info->debounce = 0;
+                e.pin_info->latched = false;
             }
         }
     }
 
+    if (has_endstop_irq)
+        NVIC_EnableIRQ(EINT3_IRQn);
+
     return 0;
 }
 
+// Called from the pin interrupt on either edge of any homing endstop when endstop_interrupt is set
+void Endstops::on_endstop_edge()
+{
+    if (this->status != MOVING_TO_ENDSTOP_SLOW && this->status != MOVING_TO_ENDSTOP_FAST)
+        return;
+
+    for (auto &e : homing_axis)
+    {
+        if (e.pin_info == nullptr || e.pin_info->latched)
+            continue;
+        int m = e.axis_index;
+
+        if (is_corexy && (m == X_AXIS || m == Y_AXIS) && !axis_to_home[m])
+            continue;
+
+        if (STEPPER[m]->is_moving() && e.pin_info->pin.get())
+        {
+            latch_axis(m);
+            e.pin_info->latched = true;
+            if (debounce_ms == 0)
+            {
+                stop_axis(m);
+                e.pin_info->triggered = true;
+            }
+        }
+    }
+}
+
+// save the step count of the motors homing axis m at the moment its endstop triggered
+void Endstops::latch_axis(int m)
+{
+    if (is_corexy && (m == X_AXIS || m == Y_AXIS))
+    {
+        latched_steps[X_AXIS] = STEPPER[X_AXIS]->get_current_step();
+        latched_steps[Y_AXIS] = STEPPER[Y_AXIS]->get_current_step();
+    }
+    else
+    {
+        latched_steps[m] = STEPPER[m]->get_current_step();
+    }
+}
+
+void Endstops::stop_axis(int m)
+{
+    if (is_corexy && (m == X_AXIS || m == Y_AXIS))
+    {
+        // corexy when moving in X or Y we need to stop both the X and Y motors
+        STEPPER[X_AXIS]->stop_moving();
+        STEPPER[Y_AXIS]->stop_moving();
+    }
+    else
+    {
+        // we signal the motor to stop, which will preempt any moves on that axis
+        STEPPER[m]->stop_moving();
+    }
+}
+
+// the motors stop some steps after the endstops triggered, so go back to where the step counts were latched
+// NOTE must be called after reset_position_from_current_actuator_position() and not while the endstops are monitored
+void Endstops::move_to_latched_position(float feed_rate)
+{
+    size_t n = homing_axis.size();
+    ActuatorCoordinates stopped_pos, latched_pos;
+    for (size_t i = 0; i < n; ++i)
+    {
+        stopped_pos[i] = latched_pos[i] = STEPPER[i]->get_current_position();
+    }
+
+    bool any = false;
+    for (auto &e : homing_axis)
+    {
+        if (e.pin_info == nullptr || !e.pin_info->latched)
+            continue;
+        int m = e.axis_index;
+        latched_pos[m] = latched_steps[m] / STEPS_PER_MM(m);
+        if (is_corexy && (m == X_AXIS || m == Y_AXIS))
+        {
+            int other = (m == X_AXIS) ? Y_AXIS : X_AXIS;
+            latched_pos[other] = latched_steps[other] / STEPS_PER_MM(other);
+        }
+        any = true;
+    }
+    if (!any)
+        return;
+
+    float delta[n];
+    for (size_t i = 0; i < n; ++i)
+        delta[i] = latched_pos[i] - stopped_pos[i];
+
+    if (!THEROBOT->disable_arm_solution)
+    {
+        // XYZ move in cartesian space, ABC are the same in both
+        float from[3], to[3];
+        THEROBOT->arm_solution->actuator_to_cartesian(stopped_pos, from);
+        THEROBOT->arm_solution->actuator_to_cartesian(latched_pos, to);
+        for (size_t i = X_AXIS; i <= Z_AXIS; ++i)
+            delta[i] = to[i] - from[i];
+    }
+
+    if (THEROBOT->delta_move(delta, feed_rate, n))
+        THECONVEYOR->wait_for_idle();
+}
+
 void Endstops::home_xy()
 {
     if (axis_to_home[X_AXIS] && axis_to_home[Y_AXIS])
@@ -740,6 +876,13 @@ void Endstops::home(axis_bitmap_t a)
     {
         e->debounce = 0;
         e->triggered = false;
+        e->latched = false;
+    }
+
+    // EINT3 is shared by all the pin interrupts and the others run it at a low priority, it is put back when homing ends
+    if (has_endstop_irq) {
+        saved_irq_priority = NVIC_GetPriority(EINT3_IRQn);
+        NVIC_SetPriority(EINT3_IRQn, 2); // same as the step ticker
     }
 
     if (is_scara)
@@ -802,6 +945,7 @@ void Endstops::home(axis_bitmap_t a)
             if ((axis_to_home[i] || this->is_delta || this->is_rdelta) && !homing_axis[i].pin_info->triggered)
             {
                 this->status = NOT_HOMING;
+                restore_endstop_irq();
                 THEKERNEL->call_event(ON_HALT, nullptr);
                 THEROBOT->disable_segmentation = false;
                 return;
@@ -817,6 +961,7 @@ void Endstops::home(axis_bitmap_t a)
             if (axis_to_home[i] && !homing_axis[i].pin_info->triggered)
             {
                 this->status = NOT_HOMING;
+                restore_endstop_irq();
                 THEKERNEL->call_event(ON_HALT, nullptr);
                 THEROBOT->disable_segmentation = false;
                 return;
@@ -856,6 +1001,10 @@ void Endstops::home(axis_bitmap_t a)
     // wait until finished
     THECONVEYOR->wait_for_idle();
 
+    // only the slow approach counts for the latched position
+    for (auto &e : endstops)
+        e->latched = false;
+
     // Start moving the axes towards the endstops slowly
     this->status = MOVING_TO_ENDSTOP_SLOW;
     for (auto &i : homing_axis)
@@ -880,6 +1029,13 @@ void Endstops::home(axis_bitmap_t a)
     // TODO Maybe only reset axis involved in the homing cycle
     THEROBOT->reset_position_from_current_actuator_position();
 
+    if (endstop_interrupt)
+    {
+        // stop monitoring as the endstops are still pressed at the latched position
+        this->status = MOVING_BACK;
+        move_to_latched_position(feed_rate);
+    }
+
     THEROBOT->disable_segmentation = false;
     if (is_scara)
     {
@@ -887,6 +1043,13 @@ void Endstops::home(axis_bitmap_t a)
     }
 
     this->status = NOT_HOMING;
+    restore_endstop_irq();
+}
+
+void Endstops::restore_endstop_irq()
+{
+    if (has_endstop_irq)
+        NVIC_SetPriority(EINT3_IRQn, saved_irq_priority);
 }
 
 void Endstops::process_home_command(Gcode *gcode)
@@ -9,11 +9,16 @@
 
 #include "libs/Module.h"
 #include "Pin.h"
+#include "ActuatorCoordinates.h"
 
 #include <bitset>
 #include <array>
 #include <map>
 
+namespace mbed {
+    class InterruptIn;
+}
+
 class StepperMotor;
 class Gcode;
 class Pin;
@@ -40,16 +45,25 @@ class Endstops : public Module{
         void process_home_command(Gcode* gcode);
         void set_homing_offset(Gcode* gcode);
         uint32_t read_endstops(uint32_t dummy);
+        void on_endstop_edge();
+        void restore_endstop_irq();
+        void latch_axis(int m);
+        void stop_axis(int m);
+        void move_to_latched_position(float feed_rate);
         void handle_park();
 
         // global settings
         float saved_position[3]{0}; // save G28 (in grbl mode)
         uint32_t debounce_count;
         uint32_t  debounce_ms;
+        uint32_t saved_irq_priority;
         axis_bitmap_t axis_to_home;
 
         float trim_mm[3];
 
+        // step counts where each motor's endstop triggered, with endstop_interrupt set
+        int32_t latched_steps[k_max_actuators];
+
         // per endstop settings
         using endstop_info_t = struct {
             Pin pin;
@@ -59,6 +73,7 @@ class Endstops : public Module{
                 uint8_t axis_index:3;
                 bool limit_enable:1;
                 bool triggered:1;
+                bool latched:1;
             };
         };
 
@@ -96,5 +111,7 @@ class Endstops : public Module{
             bool home_z_first:1;
             bool move_to_origin_after_home:1;
             bool park_after_home:1;
+            bool endstop_interrupt:1;
+            bool has_endstop_irq:1;
         };
 };
@@ -22,7 +22,7 @@ class HuanyangSpindleControl: public ModbusSpindleControl {
         void turn_on(void);
         void turn_off(void);
         void set_speed(int);
-        void report_speed(void);
+        bool poll_speed(void);
 };
 
 #endif
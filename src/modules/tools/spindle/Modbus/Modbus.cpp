@@ -5,165 +5,222 @@
       You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
 */
 
-#include "libs/Module.h"
 #include "libs/Kernel.h"
-#include "libs/nuts_bolts.h"
 #include "libs/gpio.h"
 #include "BufferedSoftSerial.h"
 #include "Modbus.h"
 
-Modbus::Modbus( PinName tx_pin, PinName rx_pin, PinName dir_pin){
-    serial = new BufferedSoftSerial( tx_pin, rx_pin );
-    serial->baud(9600);
-    serial->format(8,serial->Parity::None,1);
-    calculate_delay(9600, 8, 0, 1);
-    dir_output = new GPIO(dir_pin);
-    dir_output->output();
-    dir_output->clear();
-}
+#include <string.h>
 
-Modbus::Modbus( PinName tx_pin, PinName rx_pin, PinName dir_pin, int baud_rate){
-    serial = new BufferedSoftSerial( tx_pin, rx_pin );
+Modbus::Modbus(PinName tx_pin, PinName rx_pin, PinName dir_pin, int baud_rate, const char *format)
+{
+    serial = new BufferedSoftSerial(tx_pin, rx_pin);
     serial->baud(baud_rate);
-    serial->format(8,serial->Parity::None,1);
-    calculate_delay(baud_rate, 8, 0, 1);
-    dir_output = new GPIO(dir_pin);
-    dir_output->output();
-    dir_output->clear();
-}
 
-Modbus::Modbus( PinName tx_pin, PinName rx_pin, PinName dir_pin, int baud_rate, const char *format){
-    serial = new BufferedSoftSerial( tx_pin, rx_pin );
-    serial->baud(baud_rate);
-    
-    if(strncmp(format, "8N1", 3) == 0){
-        serial->format(8,serial->Parity::None,1);
-        calculate_delay(baud_rate, 8, 0, 1);
-    } else if(strncmp(format, "8O1", 3) == 0){
-        serial->format(8,serial->Parity::Odd,1);
-        calculate_delay(baud_rate, 8, 1, 1);
-    } else if(strncmp(format, "8E1", 3) == 0){
-        serial->format(8,serial->Parity::Even,1);
-        calculate_delay(baud_rate, 8, 1, 1);
-    } else if(strncmp(format, "8N2", 3) == 0){
-        serial->format(8,serial->Parity::None,2);
-        calculate_delay(baud_rate, 8, 0, 2);
+    int parity= 0, stop= 1;
+    if(strncmp(format, "8O1", 3) == 0) {
+        serial->format(8, serial->Parity::Odd, 1);
+        parity= 1;
+    } else if(strncmp(format, "8E1", 3) == 0) {
+        serial->format(8, serial->Parity::Even, 1);
+        parity= 1;
+    } else if(strncmp(format, "8N2", 3) == 0) {
+        serial->format(8, serial->Parity::None, 2);
+        stop= 2;
     } else {
-        serial->format(8,serial->Parity::None,1);
-        calculate_delay(baud_rate, 8, 0, 1);
+        serial->format(8, serial->Parity::None, 1);
     }
+
+    // a character is a start bit, the data bits, the parity bit and the stop bits
+    char_us= (1 + 8 + parity + stop) * 1000000 / baud_rate;
+    // telegrams are separated by at least 3.5 characters of silence, 1.75ms above 19200 baud
+    gap_us= char_us * 7 / 2;
+    if(gap_us < 1750) gap_us= 1750;
+    timeout_us= 100000;
+
     dir_output = new GPIO(dir_pin);
     dir_output->output();
     dir_output->clear();
+
+    state= IDLE;
+    tx_done= false;
+    rx_len= 0;
+    timestamp= 0;
+    errors= 0;
+
+    serial->attach_tx_done(this, &Modbus::on_tx_done);
 }
 
-// Called when the module has just been loaded
-void Modbus::on_module_loaded() {
-    // We want to be called every time a new char is received
-    serial->attach(this, &Modbus::on_serial_char_received, BufferedSoftSerial::RxIrq);
+bool Modbus::read_coil(uint8_t slave_addr, uint16_t coil_addr, uint16_t n_coils, callback_t cb)
+{
+    uint8_t telegram[6]= { slave_addr, 0x01, (uint8_t)(coil_addr >> 8), (uint8_t)coil_addr, (uint8_t)(n_coils >> 8), (uint8_t)n_coils };
+    // address, function code, byte count, a bit per coil and the CRC
+    size_t reply_len= 3 + (n_coils + 7) / 8 + 2;
+    if(n_coils == 0 || reply_len > max_reply) return false;
+    return send(telegram, sizeof(telegram), reply_len, cb);
 }
 
-// Called on Serial::RxIrq interrupt, meaning we have received a char
-void Modbus::on_serial_char_received(){
-    buffer.push_back(serial->getc());
+bool Modbus::read_holding_register(uint8_t slave_addr, uint16_t reg_addr, uint16_t n_regs, callback_t cb)
+{
+    uint8_t telegram[6]= { slave_addr, 0x03, (uint8_t)(reg_addr >> 8), (uint8_t)reg_addr, (uint8_t)(n_regs >> 8), (uint8_t)n_regs };
+    // address, function code, byte count, two bytes per register and the CRC
+    size_t reply_len= 3 + 2 * n_regs + 2;
+    if(n_regs == 0 || reply_len > max_reply) return false;
+    return send(telegram, sizeof(telegram), reply_len, cb);
 }
 
-void Modbus::read_coil(int slave_addr, int coil_addr, int n_coils){
-    char telegram[8];
-    unsigned int crc;
-    telegram[0] = slave_addr;       // Slave address
-    telegram[1] = 0x01;             // Function code
-    telegram[2] = (coil_addr >> 8); // Coil address MSB
-    telegram[3] = coil_addr & 0xFF; // Coil address LSB
-    telegram[4] = (n_coils >> 8);   // number of coils to read MSB
-    telegram[5] = n_coils & 0xFF;   // number of coils to read LSB
-    crc = crc16(telegram, 6);       
-    telegram[6] = crc;              // CRC LSB
-    telegram[7] = (crc >> 8);       // CRC MSB
-    dir_output->set();
-    serial->write(telegram,8);
-    delay((int) ceil(50 + 8 * delay_time));
-    dir_output->clear();
-    // TODO: read reply from buffer and return it
+bool Modbus::write_coil(uint8_t slave_addr, uint16_t coil_addr, bool data, callback_t cb)
+{
+    uint8_t telegram[6]= { slave_addr, 0x05, (uint8_t)(coil_addr >> 8), (uint8_t)coil_addr, (uint8_t)(data ? 0xFF : 0x00), 0x00 };
+    // the reply echoes the telegram, a later write of the same coil replaces this one if it has not been sent yet
+    return send(telegram, sizeof(telegram), 8, cb, 4);
 }
 
-void Modbus::read_holding_register(int slave_addr, int reg_addr, int n_regs){
+bool Modbus::write_holding_register(uint8_t slave_addr, uint16_t reg_addr, uint16_t data, callback_t cb)
+{
+    uint8_t telegram[6]= { slave_addr, 0x06, (uint8_t)(reg_addr >> 8), (uint8_t)reg_addr, (uint8_t)(data >> 8), (uint8_t)data };
+    return send(telegram, sizeof(telegram), 8, cb, 4);
+}
+
+bool Modbus::send(const uint8_t *data, uint8_t len, uint8_t reply_len, callback_t cb, uint8_t key_len)
+{
+    if(len + 2 > (int)max_telegram || reply_len < 4 || reply_len > max_reply) return false;
+
+    request_t *req= nullptr;
+    if(key_len > 0) {
+        // the first one may be on the line already
+        auto it= queue.begin();
+        if(it != queue.end() && (state == SENDING || state == REPLY)) ++it;
+        for(; it != queue.end(); ++it) {
+            if(it->key_len == key_len && memcmp(it->telegram, data, key_len) == 0) {
+                req= &*it;
+                break;
+            }
+        }
+    }
+
+    if(req == nullptr) {
+        if(queue.size() >= max_queue) return false;
+        queue.emplace_back();
+        req= &queue.back();
+    }
 
-    // TODO: implement this
+    memcpy(req->telegram, data, len);
+    uint16_t crc= crc16(data, len);
+    req->telegram[len]= crc & 0xFF;
+    req->telegram[len + 1]= crc >> 8;
+    req->len= len + 2;
+    req->reply_len= reply_len;
+    req->key_len= key_len;
+    req->tries= 0;
+    req->cb= cb;
+    return true;
 }
 
-void Modbus::write_coil(int slave_addr, int coil_addr, bool data){
-    char telegram[8];
-    unsigned int crc;
-    telegram[0] = slave_addr;       // Slave address
-    telegram[1] = 0x05;             // Function code
-    telegram[2] = (coil_addr >> 8); // Coil address MSB
-    telegram[3] = coil_addr & 0xFF; // Coil address LSB
-    telegram[4] = 0x00;             // Data MSB
-    telegram[5] = (data == true) ? 0xFF : 0x00; // Data LSB
-    crc = crc16(telegram, 6);       
-    telegram[6] = crc;              // CRC LSB
-    telegram[7] = (crc >> 8);       // CRC MSB
-    dir_output->set();
-    serial->write(telegram,8);
-    delay((int) ceil(50 + 8 * delay_time));
+// Called from the serial interrupt once the last character of the telegram has been sent
+void Modbus::on_tx_done()
+{
+    // let go of the line right away, the slave may answer within a few characters
     dir_output->clear();
+    tx_done= true;
 }
 
+void Modbus::start()
+{
+    request_t& req= queue.front();
 
-void Modbus::write_holding_register(int slave_addr, int reg_addr, int data){
-    char telegram[8];
-    unsigned int crc;
-    telegram[0] = slave_addr;       // Slave address
-    telegram[1] = 0x06;             // Function code
-    telegram[2] = (reg_addr >> 8);  // Register address MSB
-    telegram[3] = reg_addr;         // Register address LSB
-    telegram[4] = (data >> 8);      // Data MSB
-    telegram[5] = data;             // Data LSB
-    crc = crc16(telegram, 6);       
-    telegram[6] = crc;              // CRC LSB
-    telegram[7] = (crc >> 8);       // CRC MSB
+    // anything received since the last reply is noise
+    while(serial->readable()) serial->getc();
+    rx_len= 0;
+
+    tx_done= false;
+    state= SENDING;
+    timestamp= us_ticker_read();
     dir_output->set();
-    serial->write(telegram,8);
-    delay((int) ceil(50 + 8 * delay_time));
-    dir_output->clear();
+    serial->write(req.telegram, req.len);
 }
 
-void Modbus::diagnostic(int slave_addr, int test_sub_code, int data){
-    // TODO: implement this
-}
+void Modbus::poll()
+{
+    uint32_t now= us_ticker_read();
 
-void Modbus::write_multiple_coils(int slave_addr, int coil_addr, int n_coils, int data){
-    // TODO: implement this
-}
+    switch(state) {
+        case GAP:
+            if(now - timestamp < gap_us) return;
+            state= IDLE;
+            // fall through
 
-void Modbus::write_multiple_registers(int slave_addr, int start_addr, int data){
-    // TODO: implement this
-}
+        case IDLE:
+            if(!queue.empty()) start();
+            return;
 
-void Modbus::read_write_multiple_holding_registers(int slave_addr, int read_addr, int n_read, int write_addr, int data){
-    // TODO: implement this
+        case SENDING:
+            if(!tx_done) {
+                // the transmit interrupt should have finished long ago
+                if(now - timestamp > char_us * (queue.front().len + 2) + 10000) {
+                    dir_output->clear();
+                    finish(false, true, now);
+                }
+                return;
+            }
+            // the reply timeout runs from the end of the telegram
+            state= REPLY;
+            timestamp= now;
+            // fall through
+
+        case REPLY:
+            receive(now);
+            return;
+    }
 }
 
-void Modbus::calculate_delay(int baudrate, int bits, int parity, int stop) {
+void Modbus::receive(uint32_t now)
+{
+    while(serial->readable() && rx_len < max_reply) {
+        rx[rx_len++]= serial->getc();
+    }
+
+    const request_t& req= queue.front();
+
+    // an exception reply is the address, the function code with its top bit set, the exception code and the CRC
+    bool exception= rx_len >= 2 && (rx[1] & 0x80);
+    uint8_t expected= exception ? 5 : req.reply_len;
+
+    if(rx_len < expected) {
+        if(now - timestamp > timeout_us) finish(false, true, now);
+        return;
+    }
 
-    float bittime = 1000.0 / baudrate;
-    // here we calculate how long a byte with all surrounding bits take
-    // startbit + number of bits + parity bit + stop bit
-    delay_time = bittime * (1 + bits + parity + 1);
+    uint16_t crc= crc16(rx, expected - 2);
+    bool valid= rx[expected - 2] == (crc & 0xFF) && rx[expected - 1] == (crc >> 8) &&
+                rx[0] == req.telegram[0] && (rx[1] & 0x7F) == req.telegram[1];
+
+    // the slave understood and refused the telegram, sending it again will not help
+    finish(valid && !exception, !valid, now);
 }
 
-void Modbus::delay(unsigned int value) {
-    
-    uint32_t start = us_ticker_read(); // mbed call
-    while ((us_ticker_read() - start) < value*1000) {
-        THEKERNEL->call_event(ON_IDLE, this);
+void Modbus::finish(bool ok, bool retry, uint32_t now)
+{
+    state= GAP;
+    timestamp= now;
+
+    request_t& req= queue.front();
+    if(!ok) {
+        errors++;
+        // it is sent again after the gap
+        if(retry && ++req.tries < max_tries) return;
     }
 
+    callback_t cb= req.cb;
+    uint8_t len= ok ? req.reply_len - 2 : 0;
+    queue.pop_front();
+
+    // rx is not touched until the next telegram is started from poll()
+    if(cb) cb(ok ? rx : nullptr, len);
 }
 
-unsigned int Modbus::crc16(char *data, unsigned int len) {
-    
+uint16_t Modbus::crc16(const uint8_t *data, size_t len)
+{
     static const unsigned short crc_table[] = {
     0X0000, 0XC0C1, 0XC181, 0X0140, 0XC301, 0X03C0, 0X0280, 0XC241,
     0XC601, 0X06C0, 0X0780, 0XC741, 0X0500, 0XC5C1, 0XC481, 0X0440,
@@ -199,8 +256,8 @@ unsigned int Modbus::crc16(char *data, unsigned int len) {
     0X8201, 0X42C0, 0X4380, 0X8341, 0X4100, 0X81C1, 0X8081, 0X4040
     };
 
-    unsigned char tmp;
-    unsigned short crc = 0xFFFF;
+    uint8_t tmp;
+    uint16_t crc = 0xFFFF;
 
     while(len--) {
         tmp = *data++ ^ crc;
@@ -209,5 +266,4 @@ unsigned int Modbus::crc16(char *data, unsigned int len) {
     }
 
     return crc;
-
 }
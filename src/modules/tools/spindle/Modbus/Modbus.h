@@ -8,39 +8,84 @@
 #ifndef MODBUS_H
 #define MODBUS_H
 
-#include "libs/Module.h"
-#include <vector>
+#include "PinNames.h"
+
+#include <stdint.h>
+#include <stddef.h>
+#include <deque>
+#include <functional>
 
 class BufferedSoftSerial;
 class GPIO;
 
-class Modbus : public Module {
+// Modbus RTU master that never waits. Telegrams are queued and sent one at a time, the characters go out and
+// come in from the serial interrupts and the RS485 transmitter is turned off from the interrupt that sends the
+// last one. poll() has to be called from the main loop to start the next telegram and to collect the reply,
+// whose length is known from the telegram, its CRC is checked and it is handed to the callback of the request.
+class Modbus {
     public:
-        Modbus( PinName rx_pin, PinName tx_pin, PinName dir_pin);
-        Modbus( PinName rx_pin, PinName tx_pin, PinName dir_pin, int baud_rate);
-        Modbus( PinName rx_pin, PinName tx_pin, PinName dir_pin, int baud_rate, const char *format);
-
-        void on_module_loaded();
-        void on_serial_char_received();
-
-        void read_coil(int slave_addr, int coil_addr, int n_coils);
-        void read_holding_register(int slave_addr, int reg_addr, int n_regs);
-        void write_coil(int slave_addr, int coil_addr, bool data);
-        void write_holding_register(int slave_addr, int reg_addr, int data);
-        void diagnostic(int slave_addr, int test_sub_code, int data);
-        void write_multiple_coils(int slave_addr, int coil_addr, int n_coils, int data);
-        void write_multiple_registers(int slave_addr, int start_addr, int data);
-        void read_write_multiple_holding_registers(int slave_addr, int read_addr, int n_read, int write_addr, int data);
-        void calculate_delay(int baudrate, int bits, int parity, int stop);
-        void delay(unsigned int);
-        unsigned int crc16(char *data, unsigned int len); 
+        Modbus(PinName tx_pin, PinName rx_pin, PinName dir_pin, int baud_rate= 9600, const char *format= "8N1");
+
+        // reply is the reply telegram without its CRC, it is nullptr if none came in time, it was corrupt or was an exception
+        using callback_t = std::function<void(const uint8_t *reply, uint8_t len)>;
+
+        // these return false if the queue is full
+        bool read_coil(uint8_t slave_addr, uint16_t coil_addr, uint16_t n_coils, callback_t cb);
+        bool read_holding_register(uint8_t slave_addr, uint16_t reg_addr, uint16_t n_regs, callback_t cb);
+        bool write_coil(uint8_t slave_addr, uint16_t coil_addr, bool data, callback_t cb= nullptr);
+        bool write_holding_register(uint8_t slave_addr, uint16_t reg_addr, uint16_t data, callback_t cb= nullptr);
+        // sends a vendor specific telegram, the CRC is added. reply_len is the length of its reply including the CRC.
+        // a telegram still queued whose first key_len bytes are the same is replaced rather than a new one queued
+        bool send(const uint8_t *data, uint8_t len, uint8_t reply_len, callback_t cb= nullptr, uint8_t key_len= 0);
+
+        void poll();
+        void set_timeout(uint32_t ms) { timeout_us= ms * 1000; }
+
+        bool is_idle() const { return queue.empty() && state != SENDING && state != REPLY; }
+        size_t get_queue_size() const { return queue.size(); }
+        uint32_t get_errors() const { return errors; }
+
+        // value of register i in the reply to read_holding_register
+        static uint16_t get_register(const uint8_t *reply, int i) { return (reply[3 + 2 * i] << 8) | reply[4 + 2 * i]; }
+        static uint16_t crc16(const uint8_t *data, size_t len);
 
+    private:
+        static const size_t max_queue= 8;
+        static const size_t max_telegram= 16;
+        static const size_t max_reply= 32;
+        static const uint8_t max_tries= 3;
+
+        struct request_t {
+            uint8_t telegram[max_telegram];
+            uint8_t len;
+            uint8_t reply_len;
+            uint8_t key_len;
+            uint8_t tries;
+            callback_t cb;
+        };
+
+        void on_tx_done();
+        void start();
+        void receive(uint32_t now);
+        void finish(bool ok, bool retry, uint32_t now);
+
+        std::deque<request_t> queue;
+
+        BufferedSoftSerial *serial;
         GPIO *dir_output;
 
-        BufferedSoftSerial* serial;
-        std::vector<int> buffer;
+        uint8_t rx[max_reply];
+        uint8_t rx_len;
+
+        enum STATE { IDLE, SENDING, REPLY, GAP };
+        STATE state;
+        volatile bool tx_done;
 
-        float delay_time;        
+        uint32_t timestamp;
+        uint32_t char_us;
+        uint32_t gap_us;
+        uint32_t timeout_us;
+        uint32_t errors;
 };
 
 #endif
@@ -13,12 +13,16 @@
 #include "Config.h"
 #include "checksumm.h"
 #include "ConfigValue.h"
+#include "StreamOutputPool.h"
 #include "ModbusSpindleControl.h"
 
 #define spindle_checksum                    CHECKSUM("spindle")
 #define spindle_rx_pin_checksum             CHECKSUM("rx_pin")
 #define spindle_tx_pin_checksum             CHECKSUM("tx_pin")
 #define spindle_dir_pin_checksum            CHECKSUM("dir_pin")
+#define spindle_baud_rate_checksum          CHECKSUM("baud_rate")
+#define spindle_response_timeout_checksum   CHECKSUM("response_timeout")
+#define spindle_poll_interval_checksum      CHECKSUM("poll_interval")
 
 void ModbusSpindleControl::on_module_loaded()
 {
@@ -47,6 +51,61 @@ void ModbusSpindleControl::on_module_loaded()
     }
 
     // setup the Modbus interface
-    modbus = new Modbus(tx_pin, rx_pin, dir_pin);
+    int baud_rate = THEKERNEL->config->value(spindle_checksum, spindle_baud_rate_checksum)->by_default(9600)->as_int();
+    modbus = new Modbus(tx_pin, rx_pin, dir_pin, baud_rate);
+    modbus->set_timeout(THEKERNEL->config->value(spindle_checksum, spindle_response_timeout_checksum)->by_default(100)->as_int());
+
+    // in milliseconds, 0 only reads the speed for M957
+    poll_interval = THEKERNEL->config->value(spindle_checksum, spindle_poll_interval_checksum)->by_default(1000)->as_int() * 1000;
+    last_poll = us_ticker_read();
+    current_rpm = 0;
+    rpm_valid = false;
+    report_pending = false;
+
+    // the telegrams are sent and the replies collected from here
+    register_for_event(ON_IDLE);
+}
+
+void ModbusSpindleControl::on_idle(void *argument)
+{
+    modbus->poll();
+
+    if(poll_interval == 0 || !modbus->is_idle()) return;
+
+    uint32_t now = us_ticker_read();
+    if(now - last_poll >= poll_interval) {
+        last_poll = now;
+        poll_speed();
+    }
+}
+
+void ModbusSpindleControl::update_speed(bool valid, int rpm)
+{
+    rpm_valid = valid;
+    if(valid) current_rpm = rpm;
+
+    if(report_pending) {
+        report_pending = false;
+        if(valid) {
+            THEKERNEL->streams->printf("Current RPM: %d\n", rpm);
+        } else {
+            THEKERNEL->streams->printf("Error: no reply from the spindle\n");
+        }
+    }
+}
+
+void ModbusSpindleControl::report_speed()
+{
+    // the speed polled last is recent enough
+    if(poll_interval != 0 && rpm_valid) {
+        THEKERNEL->streams->printf("Current RPM: %d\n", current_rpm);
+        return;
+    }
+
+    // otherwise it is reported when the reply comes in
+    if(!report_pending) {
+        report_pending = poll_speed();
+        if(!report_pending) THEKERNEL->streams->printf("Error: spindle speed could not be read\n");
+    }
 }
 
@@ -13,19 +13,33 @@
 class Modbus;
 
 // This module implements Modbus control for spindle control over Modbus.
+// The telegrams are queued on the Modbus engine and sent from on_idle, so changing the speed does not hold up
+// the gcode. The speed of the spindle is read every poll_interval and kept for M957.
 class ModbusSpindleControl: public SpindleControl {
     public:
         ModbusSpindleControl() {};
         virtual ~ModbusSpindleControl() {};
         void on_module_loaded();
-        
+        void on_idle(void *argument);
+
         Modbus* modbus;
-        
-        virtual void turn_on(void);
-        virtual void turn_off(void);
-        virtual void set_speed(int);
-        virtual void report_speed(void);
 
+    protected:
+        // queues the telegram that reads the speed, its reply is passed on to update_speed()
+        virtual bool poll_speed(void) { return false; };
+        // rpm is the speed read, valid is false if the spindle did not reply
+        void update_speed(bool valid, int rpm);
+
+    private:
+        void report_speed(void);
+
+        uint32_t poll_interval;
+        uint32_t last_poll;
+        int current_rpm;
+        struct {
+            bool rpm_valid:1;
+            bool report_pending:1;
+        };
 };
 
 #endif
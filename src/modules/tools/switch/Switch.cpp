@@ -15,6 +15,7 @@
 #include "PublicDataRequest.h"
 #include "SwitchPublicAccess.h"
 #include "SlowTicker.h"
+#include "PwmEngine.h"
 #include "Config.h"
 #include "Gcode.h"
 #include "checksumm.h"
@@ -272,7 +273,7 @@ void Switch::on_config_reload(void *argument)
 
     if(this->output_type == SIGMADELTA) {
         // SIGMADELTA
-        THEKERNEL->slow_ticker->attach(1000, this->sigmadelta_pin, &Pwm::on_tick);
+        PwmEngine::getInstance()->add(this->sigmadelta_pin, 1000);
     }
 
     // for commands we need to replace _ for space
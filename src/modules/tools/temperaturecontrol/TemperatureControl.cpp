@@ -21,6 +21,7 @@
 #include "checksumm.h"
 #include "Gcode.h"
 #include "SlowTicker.h"
+#include "PwmEngine.h"
 #include "ConfigValue.h"
 #include "PID_Autotuner.h"
 #include "SerialMessage.h"
@@ -247,7 +248,7 @@ void TemperatureControl::load_config()
         this->heater_pin.set(0);
         set_low_on_debug(heater_pin.port_number, heater_pin.pin);
         // activate SD-DAC timer
-        THEKERNEL->slow_ticker->attach(THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, pwm_frequency_checksum)->by_default(2000)->as_number(), &heater_pin, &Pwm::on_tick);
+        PwmEngine::getInstance()->add(&heater_pin, THEKERNEL->config->value(temperature_control_checksum, this->name_checksum, pwm_frequency_checksum)->by_default(2000)->as_number());
     }
 
     // reading tick
@@ -729,10 +729,8 @@ void FiveAxisStrategy::setFirstAdjustFunction(bool on)
 {
     if (on)
     {
-        // set compensation function
-        using std::placeholders::_1;
-        using std::placeholders::_2;
-        THEROBOT->compensationTransform = std::bind(&FiveAxisStrategy::firstCompensationFunction, this, _1, _2);
+        // set compensation function, a lambda lets the call into it be inlined where std::bind calls through a member pointer
+        THEROBOT->compensationTransform = [this](float *target, bool inverse) { firstCompensationFunction(target, inverse); };
     }
     else
     {
@@ -760,9 +758,7 @@ void FiveAxisStrategy::setSecondAdjustFunction(bool on)
     if (on)
     {
         // set compensation function
-        using std::placeholders::_1;
-        using std::placeholders::_2;
-        THEROBOT->compensationTransform = std::bind(&FiveAxisStrategy::secondCompensationFunction, this, _1, _2);
+        THEROBOT->compensationTransform = [this](float *target, bool inverse) { secondCompensationFunction(target, inverse); };
     }
     else
     {
@@ -775,9 +771,7 @@ void FiveAxisStrategy::setFinalAdjustFunction(bool on)
     if (on)
     {
         // set compensation function
-        using std::placeholders::_1;
-        using std::placeholders::_2;
-        THEROBOT->compensationTransform = std::bind(&FiveAxisStrategy::finalCompensationFunction, this, _1, _2);
+        THEROBOT->compensationTransform = [this](float *target, bool inverse) { finalCompensationFunction(target, inverse); };
     }
     else
     {
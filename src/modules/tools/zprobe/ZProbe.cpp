@@ -27,6 +27,8 @@
 #include "StepTicker.h"
 #include "utils.h"
 
+#include "InterruptIn.h" // mbed
+
 // strategies we know about
 #include "DeltaCalibrationStrategy.h"
 #include "ThreePointStrategy.h"
@@ -45,6 +47,7 @@
 #define max_z_checksum CHECKSUM("max_z")
 #define reverse_z_direction_checksum CHECKSUM("reverse_z")
 #define dwell_before_probing_checksum CHECKSUM("dwell_before_probing")
+#define probe_interrupt_checksum CHECKSUM("probe_interrupt")
 
 // from endstop section
 #define delta_homing_checksum CHECKSUM("delta_homing")
@@ -83,6 +86,20 @@ void ZProbe::config_load()
     this->pin.from_string(THEKERNEL->config->value(zprobe_checksum, probe_pin_checksum)->by_default("nc")->as_string())->as_input();
     this->debounce_ms = THEKERNEL->config->value(zprobe_checksum, debounce_ms_checksum)->by_default(0)->as_number();
 
+    // stop the motors from the pin interrupt rather than the 1ms poll, debounce_ms then becomes a confirmation window
+    this->probe_interrupt = THEKERNEL->config->value(zprobe_checksum, probe_interrupt_checksum)->by_default(false)->as_bool();
+    if (this->probe_interrupt && this->pin.connected())
+    {
+        // only pins on ports 0 and 2 can interrupt, others are still polled but the position is latched where the poll saw it
+        if (this->pin.port_number == 0 || this->pin.port_number == 2)
+        {
+            this->probe_irq = this->pin.interrupt_pin(true);
+            // the probe may be NO or NC or inverted by G38.4 so take both edges and check the level in the handler
+            this->probe_irq->rise(this, &ZProbe::on_probe_edge);
+            this->probe_irq->fall(this, &ZProbe::on_probe_edge);
+        }
+    }
+
     // get strategies to load
     vector<uint16_t> modules;
     THEKERNEL->config->get_module_list(&modules, leveling_strategy_checksum);
@@ -172,33 +189,113 @@ uint32_t ZProbe::read_probe(uint32_t dummy)
     // we check all axis as it maybe a G38.2 X10 for instance, not just a probe in Z
     if (STEPPER[X_AXIS]->is_moving() || STEPPER[Y_AXIS]->is_moving() || STEPPER[Z_AXIS]->is_moving())
     {
+        // the edge interrupt also sets the latch and may stop the motors
+        if (probe_irq != nullptr)
+            NVIC_DisableIRQ(EINT3_IRQn);
+
         // if it is moving then we check the probe, and debounce it
         if (this->pin.get() != invert_probe)
         {
+            // an edge can be missed while the pin bounces, so this latches it as a fallback
+            if (probe_interrupt && !latched)
+                latch_probe();
+
             if (debounce < debounce_ms)
             {
                 debounce++;
             }
             else
             {
-                // we signal the motors to stop, which will preempt any moves on that axis
-                // we do all motors as it may be a delta
-                for (auto &a : THEROBOT->actuators)
-                    a->stop_moving();
-                probe_detected = true;
-                debounce = 0;
+                trigger_probe();
             }
         }
         else
         {
             // The endstop was not hit yet
             debounce = 0;
+            latched = false;
         }
+
+        if (probe_irq != nullptr)
+            NVIC_EnableIRQ(EINT3_IRQn);
     }
 
     return 0;
 }
 
+// EINT3 is shared by all the pin interrupts, which run it at a low priority. While probing the edge has to get in
+// ahead of the step ticker, so it is raised for the probe move and the priority it had is put back after it
+void ZProbe::raise_probe_irq()
+{
+    if (probe_irq == nullptr)
+        return;
+    saved_irq_priority = NVIC_GetPriority(EINT3_IRQn);
+    NVIC_SetPriority(EINT3_IRQn, 2); // same as the step ticker
+}
+
+void ZProbe::restore_probe_irq()
+{
+    if (probe_irq == nullptr)
+        return;
+    NVIC_SetPriority(EINT3_IRQn, saved_irq_priority);
+}
+
+// Called from the pin interrupt on either edge of the probe when probe_interrupt is set
+void ZProbe::on_probe_edge()
+{
+    if (!probing || probe_detected || latched)
+        return;
+
+    // the interrupt does not know about inverted pins
+    if (this->pin.get() == invert_probe)
+        return;
+
+    if (STEPPER[X_AXIS]->is_moving() || STEPPER[Y_AXIS]->is_moving() || STEPPER[Z_AXIS]->is_moving())
+    {
+        latch_probe();
+        if (debounce_ms == 0)
+            trigger_probe();
+    }
+}
+
+// save the step counts at the moment the probe triggered, the motors keep going until it is confirmed
+void ZProbe::latch_probe()
+{
+    for (int i = X_AXIS; i <= Z_AXIS; i++)
+        latched_steps[i] = STEPPER[i]->get_current_step();
+    latched = true;
+}
+
+void ZProbe::trigger_probe()
+{
+    // we signal the motors to stop, which will preempt any moves on that axis
+    // we do all motors as it may be a delta
+    for (auto &a : THEROBOT->actuators)
+        a->stop_moving();
+    probe_detected = true;
+    debounce = 0;
+}
+
+// the motors stop some steps after the probe triggered, so go back to where the step counts were latched
+// NOTE must be called after reset_position_from_current_actuator_position()
+void ZProbe::move_to_latched_position(float feedrate)
+{
+    ActuatorCoordinates stopped_pos, latched_pos;
+    for (int i = X_AXIS; i <= Z_AXIS; i++)
+    {
+        stopped_pos[i] = STEPPER[i]->get_current_position();
+        latched_pos[i] = latched_steps[i] / STEPS_PER_MM(i);
+    }
+
+    float from[3], to[3];
+    THEROBOT->arm_solution->actuator_to_cartesian(stopped_pos, from);
+    THEROBOT->arm_solution->actuator_to_cartesian(latched_pos, to);
+
+    float delta[3] = {to[X_AXIS] - from[X_AXIS], to[Y_AXIS] - from[Y_AXIS], to[Z_AXIS] - from[Z_AXIS]};
+    if (THEROBOT->delta_move(delta, feedrate, 3))
+        THECONVEYOR->wait_for_idle();
+}
+
 // single probe in Z with custom feedrate
 // returns boolean value indicating if probe was triggered
 bool ZProbe::run_probe(float &mm, float feedrate, float max_dist, bool reverse)
@@ -217,6 +314,8 @@ bool ZProbe::run_probe(float &mm, float feedrate, float max_dist, bool reverse)
     probing = true;
     probe_detected = false;
     debounce = 0;
+    latched = false;
+    raise_probe_irq();
 
     // save current actuator position so we can report how far we moved
     float z_start_pos = THEROBOT->actuators[Z_AXIS]->get_current_position();
@@ -229,12 +328,14 @@ bool ZProbe::run_probe(float &mm, float feedrate, float max_dist, bool reverse)
 
     // wait until finished
     THECONVEYOR->wait_for_idle();
+    restore_probe_irq();
     if (THEKERNEL->is_halted())
         return false;
 
     // now see how far we moved, get delta in z we moved
     // NOTE this works for deltas as well as all three actuators move the same amount in Z
-    mm = z_start_pos - THEROBOT->actuators[2]->get_current_position();
+    bool use_latch = probe_detected && latched;
+    mm = z_start_pos - (use_latch ? latched_steps[Z_AXIS] / Z_STEPS_PER_MM : THEROBOT->actuators[2]->get_current_position());
 
     // set the last probe position to the actuator units moved during this home
     THEROBOT->set_last_probe_position(std::make_tuple(0, 0, mm, probe_detected ? 1 : 0));
@@ -245,6 +346,8 @@ bool ZProbe::run_probe(float &mm, float feedrate, float max_dist, bool reverse)
     {
         // if the probe stopped the move we need to correct the last_milestone as it did not reach where it thought
         THEROBOT->reset_position_from_current_actuator_position();
+        if (use_latch)
+            move_to_latched_position(feedrate);
     }
 
     return probe_detected;
@@ -497,6 +600,8 @@ void ZProbe::probe_XYZ(Gcode *gcode)
     probing = true;
     probe_detected = false;
     debounce = 0;
+    latched = false;
+    raise_probe_irq();
 
     // do a delta move which will stop as soon as the probe is triggered, or the distance is reached
     float delta[3] = {x, y, z};
@@ -504,10 +609,12 @@ void ZProbe::probe_XYZ(Gcode *gcode)
     {
         gcode->stream->printf("error:No move detected or too small\n");
         probing = false;
+        restore_probe_irq();
         return;
     }
 
     THEKERNEL->conveyor->wait_for_idle();
+    restore_probe_irq();
 
     // disable probe checking
     probing = false;
@@ -515,6 +622,8 @@ void ZProbe::probe_XYZ(Gcode *gcode)
     // if the probe stopped the move we need to correct the last_milestone as it did not reach where it thought
     // this also sets last_milestone to the machine coordinates it stopped at
     THEROBOT->reset_position_from_current_actuator_position();
+    if (probe_detected && latched)
+        move_to_latched_position(rate);
     float pos[3];
     THEROBOT->get_axis_position(pos, 3);
 
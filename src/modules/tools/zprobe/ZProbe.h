@@ -17,6 +17,10 @@
 #define zprobe_checksum            CHECKSUM("zprobe")
 #define leveling_strategy_checksum CHECKSUM("leveling-strategy")
 
+namespace mbed {
+    class InterruptIn;
+}
+
 class StepperMotor;
 class Gcode;
 class StreamOutput;
@@ -49,6 +53,12 @@ private:
     void config_load();
     void probe_XYZ(Gcode *gc);
     uint32_t read_probe(uint32_t dummy);
+    void on_probe_edge();
+    void raise_probe_irq();
+    void restore_probe_irq();
+    void latch_probe();
+    void trigger_probe();
+    void move_to_latched_position(float feedrate);
 
     float slow_feedrate;
     float fast_feedrate;
@@ -61,6 +71,12 @@ private:
     std::vector<LevelingStrategy*> strategies;
     uint16_t debounce_ms, debounce;
 
+    // with probe_interrupt set the step counts are latched where the probe triggered
+    mbed::InterruptIn *probe_irq{nullptr};
+    uint32_t saved_irq_priority;
+    int32_t latched_steps[3];
+    volatile bool latched{false};
+
     volatile struct {
         bool is_delta:1;
         bool is_rdelta:1;
@@ -68,6 +84,7 @@ private:
         bool reverse_z:1;
         bool invert_override:1;
         bool invert_probe:1;
+        bool probe_interrupt:1;
         volatile bool probe_detected:1;
     };
 };
@@ -9,6 +9,7 @@
 #include "Gcode.h"
 #include "checksumm.h"
 #include "SlowTicker.h"
+#include "PwmEngine.h"
 #include "ConfigValue.h"
 #include "PwmOut.h"
 #include "PublicDataRequest.h"
@@ -71,10 +72,10 @@ void LedStrip::on_config_reload(void *argument)
 
     this->set_color(255.0F, 255.0F, 255.0F);
 
-    THEKERNEL->slow_ticker->attach(20000, this->leds[RED], &Pwm::on_tick);
-    THEKERNEL->slow_ticker->attach(20000, this->leds[GREEN], &Pwm::on_tick);
-    THEKERNEL->slow_ticker->attach(20000, this->leds[BLUE], &Pwm::on_tick);
-    THEKERNEL->slow_ticker->attach(20000, this->leds[WHITE], &Pwm::on_tick);
+    PwmEngine::getInstance()->add(this->leds[RED], 20000);
+    PwmEngine::getInstance()->add(this->leds[GREEN], 20000);
+    PwmEngine::getInstance()->add(this->leds[BLUE], 20000);
+    PwmEngine::getInstance()->add(this->leds[WHITE], 20000);
 
     THEKERNEL->slow_ticker->attach(1, this, &LedStrip::led_tick);
 }
@@ -686,7 +686,8 @@ bool Panel::mount_external_sd(bool on)
             size_t n= sizeof(SDCard);
             void *v = AHB0.alloc(n);
             memset(v, 0, n); // clear the allocated memory
-            this->sd= new(v) SDCard(mosi, miso, sclk, cs); // allocate object using zeroed memory
+            // this card is at the end of the panel cable so it keeps the old 2.5MHz clock
+            this->sd= new(v) SDCard(mosi, miso, sclk, cs, 2500000); // allocate object using zeroed memory
         }
         delete this->extmounter; // if it was not unmounted before
         size_t n= sizeof(SDFAT);
@@ -0,0 +1,100 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "CompactGcode.h"
+#include "FileLineReader.h"
+
+#include <string.h>
+
+#define COMPACT_VERSION 1
+#define COMPACT_MAX_DECIMALS 6
+
+#define OP_NOP  0x00
+#define OP_TEXT 0x01
+#define OP_MOVE 0x10
+
+static const char word_letters[] = "XYZABCEFS";
+
+CompactGcode::CompactGcode()
+{
+    g = 0;
+    params[0] = '\0';
+    memset(last, 0, sizeof(last));
+    divisor = 1;
+}
+
+bool CompactGcode::start(FileLineReader *reader)
+{
+    char header[8];
+    if(reader->peek(header, sizeof(header)) != sizeof(header)) return false;
+    if(memcmp(header, "SGCB", 4) != 0 || header[4] != COMPACT_VERSION || header[5] > COMPACT_MAX_DECIMALS) return false;
+
+    reader->read(header, sizeof(header));
+
+    divisor = 1;
+    for (int i = 0; i < header[5]; ++i) {
+        divisor *= 10;
+    }
+    memset(last, 0, sizeof(last));
+    return true;
+}
+
+bool CompactGcode::get_varint(FileLineReader *reader, uint32_t &v, size_t &len)
+{
+    v = 0;
+    for (int shift = 0; shift < 35; shift += 7) {
+        int b = reader->get_byte();
+        if(b < 0) return false;
+        ++len;
+        v |= (uint32_t)(b & 0x7F) << shift;
+        if((b & 0x80) == 0) return true;
+    }
+    return false;
+}
+
+CompactGcode::RECORD_T CompactGcode::next(FileLineReader *reader, std::string &text, size_t &len)
+{
+    len = 0;
+
+    int op;
+    do {
+        op = reader->get_byte();
+        if(op < 0) return END;
+        ++len;
+    } while(op == OP_NOP);
+
+    uint32_t v;
+    if(op == OP_TEXT) {
+        if(!get_varint(reader, v, len) || v > 255) return BAD;
+        text.resize(v);
+        if(!reader->read(&text[0], v)) return BAD;
+        len += v;
+        return TEXT;
+    }
+
+    if((op & ~0x03) != OP_MOVE) return BAD;
+
+    int mask = reader->get_byte();
+    if(mask < 0) return BAD;
+    ++len;
+    if(op & 0x02) mask |= 1 << 8; // S
+
+    g = op & 0x01;
+    int n = 0;
+    for (int i = 0; i < n_words; ++i) {
+        if((mask & (1 << i)) == 0) continue;
+
+        if(!get_varint(reader, v, len)) return BAD;
+        last[i] += (int32_t)(v >> 1) ^ -(int32_t)(v & 1); // zigzag
+        params[n] = word_letters[i];
+        values[n] = last[i] / divisor;
+        ++n;
+    }
+    params[n] = '\0';
+
+    return MOVE;
+}
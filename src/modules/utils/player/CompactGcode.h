@@ -0,0 +1,57 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string>
+
+class FileLineReader;
+
+/*
+Compact binary G-code, made from text G-code with gcode-compact.py and played without parsing any text.
+
+The file starts with an 8 byte header: "SGCB", the format version (1), the number of decimals the values are
+kept to and two reserved bytes. Then come records, each starting with an opcode byte:
+
+  0x00       nothing, padding
+  0x01       a text line: its length as a varint then the line without the newline, used for anything that is
+             not a simple move, it is played the way a line from a text file is
+  0x10-0x13  a G0 (bit 0 clear) or G1 (bit 0 set) move, with an S word if bit 1 is set. Next is a mask byte with
+             bit 0 to 7 set for each of X Y Z A B C E F that is in the move, then for each word present in
+             XYZABCEF then S order the change from the last value that letter had, as a zigzag varint in units
+             of 10^-decimals
+
+The values are the words as they were written, so G90/G91, G20/G21, work offsets and so on apply as they would
+to the text. Varints are little endian groups of 7 bits with the top bit set on all but the last byte.
+*/
+class CompactGcode {
+    public:
+        CompactGcode();
+
+        enum RECORD_T { END, MOVE, TEXT, BAD };
+
+        // uses up the header if the file has one and returns true, otherwise the reader is left as it was
+        bool start(FileLineReader *reader);
+
+        // decodes the next record, a move into g, params and values and a text line into text.
+        // len is set to the number of bytes used
+        RECORD_T next(FileLineReader *reader, std::string &text, size_t &len);
+
+        static const int n_words = 9;
+
+        unsigned int g;
+        char params[n_words + 1];   // the letters in the move in order, nul terminated
+        float values[n_words];      // and their values
+
+    private:
+        bool get_varint(FileLineReader *reader, uint32_t &v, size_t &len);
+
+        int32_t last[n_words];      // last value of each of XYZABCEFS in units
+        float divisor;
+};
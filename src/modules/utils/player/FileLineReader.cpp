@@ -0,0 +1,173 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "FileLineReader.h"
+
+#include "platform_memory.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+
+FileLineReader::FileLineReader()
+{
+    fill[0] = fill[1] = 0;
+    pos = 0;
+    current = 0;
+    eof = false;
+}
+
+FileLineReader::~FileLineReader()
+{
+    stop();
+}
+
+bool FileLineReader::start(FILE *fp)
+{
+    stop();
+
+    // the buffers go in AHB SRAM if there is room as the SD card can DMA straight into it
+    buffers = (char *)AHB0.alloc(2 * buffer_size);
+    if(buffers == nullptr) {
+        buffers = new char[2 * buffer_size];
+    }
+
+    // read the descriptor directly, newlib-nano would read an unbuffered stream a byte at a time
+    // and a buffered one would copy every sector through its own buffer
+    long offset = ftell(fp);
+    fd = fileno(fp);
+    if(offset < 0 || lseek(fd, offset, SEEK_SET) != offset) {
+        stop();
+        return false;
+    }
+
+    fill[0] = fill[1] = 0;
+    pos = 0;
+    current = 0;
+    eof = false;
+    return true;
+}
+
+void FileLineReader::stop()
+{
+    if(buffers != nullptr) {
+        if(AHB0.has(buffers)) {
+            AHB0.dealloc(buffers);
+        } else {
+            delete [] buffers;
+        }
+        buffers = nullptr;
+    }
+    fd = -1;
+}
+
+bool FileLineReader::read_buffer(int b)
+{
+    if(eof) return false;
+
+    int n = ::read(fd, buffers + b * buffer_size, buffer_size);
+    if(n < (int)buffer_size) eof = true;
+    fill[b] = n > 0 ? n : 0;
+    return fill[b] > 0;
+}
+
+bool FileLineReader::prefetch()
+{
+    if(fd < 0) return false;
+
+    // the current buffer may still have lines being handed out, only the other one is ever read into
+    int spare = current ^ 1;
+    if(fill[spare] != 0) return false;
+    return read_buffer(spare);
+}
+
+// makes sure there is something at pos, moving on to the other buffer once this one is used up
+// and reading it now if on_idle did not get to it first. returns false at the end of the file
+bool FileLineReader::next_data()
+{
+    if(pos < fill[current]) return true;
+
+    fill[current] = 0;
+    int spare = current ^ 1;
+    if(fill[spare] == 0 && !read_buffer(spare)) return false;
+    current = spare;
+    pos = 0;
+    return true;
+}
+
+bool FileLineReader::next_line(const char *&line, size_t &len)
+{
+    if(fd < 0) return false;
+
+    size_t carried = 0;
+    len = 0;
+
+    while(true) {
+        if(!next_data()) {
+            // end of file, the last line may not have a newline
+            if(len == 0) return false;
+            line = len <= max_line ? carry : nullptr;
+            return true;
+        }
+
+        const char *p = buffers + current * buffer_size + pos;
+        size_t n = fill[current] - pos;
+        const char *nl = (const char *)memchr(p, '\n', n);
+        if(nl != nullptr) n = nl - p + 1;
+        pos += n;
+
+        if(len == 0 && nl != nullptr) {
+            // the whole line is in this buffer
+            len = n;
+            line = len <= max_line ? p : nullptr;
+            return true;
+        }
+
+        // the line carries on into the next buffer, keep what we have unless it is already too long
+        if(len + n <= max_line) {
+            memcpy(carry + carried, p, n);
+            carried += n;
+        }
+        len += n;
+
+        if(nl != nullptr) {
+            line = len <= max_line ? carry : nullptr;
+            return true;
+        }
+    }
+}
+
+int FileLineReader::get_byte()
+{
+    if(fd < 0 || !next_data()) return -1;
+    return (uint8_t)buffers[current * buffer_size + pos++];
+}
+
+bool FileLineReader::read(void *dst, size_t n)
+{
+    if(fd < 0) return false;
+
+    char *d = (char *)dst;
+    while(n > 0) {
+        if(!next_data()) return false;
+        size_t a = std::min(n, fill[current] - pos);
+        memcpy(d, buffers + current * buffer_size + pos, a);
+        pos += a;
+        d += a;
+        n -= a;
+    }
+    return true;
+}
+
+size_t FileLineReader::peek(void *dst, size_t n)
+{
+    if(fd < 0 || !next_data()) return 0;
+
+    size_t a = std::min(n, fill[current] - pos);
+    memcpy(dst, buffers + current * buffer_size + pos, a);
+    return a;
+}
@@ -0,0 +1,58 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Reads a file ahead of the player in whole sectors, into two buffers used in turn.
+// While the lines in one buffer are being handed out the other one can be refilled, from on_idle when the
+// planner queue is full, so the SD card is rarely read while the queue is waiting for the next line.
+// Lines are returned as pointers into the buffers, only a line that straddles the two is copied.
+class FileLineReader {
+    public:
+        FileLineReader();
+        ~FileLineReader();
+
+        // start reading fp from its current position, the stream must not be read through stdio after this
+        bool start(FILE *fp);
+        void stop();
+        bool is_active() const { return fd >= 0; }
+
+        // refills the spare buffer if it is empty, returns true if the card was read
+        bool prefetch();
+
+        // gets the next line including its newline, the pointer is valid until the next call.
+        // lines longer than max_line are skipped and returned as nullptr with their length.
+        // returns false at the end of the file
+        bool next_line(const char *&line, size_t &len);
+
+        // byte access for the compact binary format, get_byte returns -1 at the end of the file
+        int get_byte();
+        bool read(void *dst, size_t n);
+        // copies upto n bytes without using them up, only what is left in the current buffer
+        size_t peek(void *dst, size_t n);
+
+        static const size_t max_line = 129; // 128 characters and the newline
+        static const size_t buffer_size = 1024; // two sectors, so the card can do a multiple block read
+
+    private:
+        bool read_buffer(int b);
+        bool next_data();
+
+        char *buffers{nullptr};
+        size_t fill[2];    // valid bytes in each buffer, 0 if it needs to be read
+        size_t pos;        // next byte in the current buffer
+        char carry[max_line];
+        int fd{-1};
+        struct {
+            uint8_t current:1;
+            bool eof:1;
+        };
+};
@@ -6,6 +6,8 @@
 */
 
 #include "Player.h"
+#include "FileLineReader.h"
+#include "CompactGcode.h"
 
 #include "libs/Kernel.h"
 #include "Robot.h"
@@ -16,6 +18,7 @@
 #include "libs/StreamOutputPool.h"
 #include "libs/StreamOutput.h"
 #include "Gcode.h"
+#include "GcodeDispatch.h"
 #include "checksumm.h"
 #include "Config.h"
 #include "ConfigValue.h"
@@ -53,12 +56,16 @@ Player::Player()
     this->reply_stream = nullptr;
     this->suspended= false;
     this->suspend_loops= 0;
+    this->reader = new FileLineReader();
+    this->compact = new CompactGcode();
+    this->compact_file = false;
 }
 
 void Player::on_module_loaded()
 {
     this->register_for_event(ON_CONSOLE_LINE_RECEIVED);
     this->register_for_event(ON_MAIN_LOOP);
+    this->register_for_event(ON_IDLE);
     this->register_for_event(ON_SECOND_TICK);
     this->register_for_event(ON_GET_PUBLIC_DATA);
     this->register_for_event(ON_SET_PUBLIC_DATA);
@@ -127,6 +134,7 @@ void Player::on_gcode_received(void *argument)
 
             if(this->current_file_handler != NULL) {
                 this->playing_file = false;
+                this->reader->stop();
                 fclose(this->current_file_handler);
             }
             this->current_file_handler = fopen( this->filename.c_str(), "r");
@@ -144,6 +152,7 @@ void Player::on_gcode_received(void *argument)
                     this->file_size = ftell(this->current_file_handler);
                     fseek(this->current_file_handler, 0, SEEK_SET);
                 }
+                this->start_reader();
                 gcode->stream->printf("File opened:%s Size:%ld\r\n", this->filename.c_str(), this->file_size);
                 gcode->stream->printf("File selected\r\n");
             }
@@ -181,7 +190,16 @@ void Player::on_gcode_received(void *argument)
                     } else {
                         this->filename = currentfn;
                         this->file_size = old_size;
+                        this->start_reader();
                         this->current_stream = nullptr;
+
+                        if(gcode->has_letter('S') && !this->compact_file) {
+                            // M26 Snnn sets M24 to play a text file from that byte, eg the one M27 last reported.
+                            // the seek looks up the cluster in the file's link map so it is quick anywhere in the file
+                            this->played_cnt = gcode->get_uint('S');
+                            fseek(this->current_file_handler, this->played_cnt, SEEK_SET);
+                            this->reader->start(this->current_file_handler);
+                        }
                     }
                 }
             } else {
@@ -198,6 +216,7 @@ void Player::on_gcode_received(void *argument)
 
             if(this->current_file_handler != NULL) {
                 this->playing_file = false;
+                this->reader->stop();
                 fclose(this->current_file_handler);
             }
 
@@ -215,6 +234,7 @@ void Player::on_gcode_received(void *argument)
                         file_size = ftell(this->current_file_handler);
                         fseek(this->current_file_handler, 0, SEEK_SET);
                 }
+                this->start_reader();
             }
 
             this->played_cnt = 0;
@@ -287,6 +307,7 @@ void Player::play_command( string parameters, StreamOutput *stream )
     }
 
     if(this->current_file_handler != NULL) { // must have been a paused print
+        this->reader->stop();
         fclose(this->current_file_handler);
     }
 
@@ -318,6 +339,7 @@ void Player::play_command( string parameters, StreamOutput *stream )
         fseek(this->current_file_handler, 0, SEEK_SET);
         stream->printf("  File size %ld\r\n", file_size);
     }
+    this->start_reader();
     this->played_cnt = 0;
     this->elapsed_secs = 0;
 }
@@ -378,6 +400,7 @@ void Player::abort_command( string parameters, StreamOutput *stream )
     file_size = 0;
     this->filename = "";
     this->current_stream = NULL;
+    reader->stop();
     fclose(current_file_handler);
     current_file_handler = NULL;
     if(parameters.empty()) {
@@ -415,36 +438,37 @@ void Player::on_main_loop(void *argument)
             return;
         }
 
-        char buf[130]; // lines upto 128 characters are allowed, anything longer is discarded
-        bool discard = false;
+        if(this->compact_file) {
+            if(play_compact()) return;
 
-        while(fgets(buf, sizeof(buf), this->current_file_handler) != NULL) {
-            int len = strlen(buf);
-            if(len == 0) continue; // empty line? should not be possible
-            if(buf[len - 1] == '\n' || feof(this->current_file_handler)) {
-                if(discard) { // we are discarding a long line
-                    discard = false;
+        } else {
+            // feed lines while the queue has room, the last one may wait in on_idle for the queue to drain,
+            // and stop if a line paused, suspended or aborted the file
+            const char *line;
+            size_t len;
+            int fed = 0;
+            while(this->reader->next_line(line, len)) {
+                played_cnt += len;
+
+                if(line == nullptr) {
+                    // lines upto 128 characters are allowed, anything longer is discarded
+                    if(this->current_stream != nullptr) { this->current_stream->printf("Warning: Discarded long line\n"); }
                     continue;
                 }
                 if(len == 1) continue; // empty line
 
-                if(this->current_stream != nullptr) {
-                    this->current_stream->printf("%s", buf);
-                }
-
                 struct SerialMessage message;
-                message.message = buf;
+                message.message.assign(line, len);
                 message.stream = this->current_stream == nullptr ? &(StreamOutput::NullStream) : this->current_stream;
 
+                if(this->current_stream != nullptr) {
+                    this->current_stream->printf("%s", message.message.c_str());
+                }
+
                 // waits for the queue to have enough room
                 THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
-                played_cnt += len;
-                return; // we feed one line per main loop
 
-            } else {
-                // discard long line
-                if(this->current_stream != nullptr) { this->current_stream->printf("Warning: Discarded long line\n"); }
-                discard = true;
+                if(!this->playing_file || THEKERNEL->is_halted() || THECONVEYOR->is_queue_full() || ++fed >= 32) return;
             }
         }
 
@@ -452,6 +476,7 @@ void Player::on_main_loop(void *argument)
         this->filename = "";
         played_cnt = 0;
         file_size = 0;
+        this->reader->stop();
         fclose(this->current_file_handler);
         current_file_handler = NULL;
         this->current_stream = NULL;
@@ -464,6 +489,72 @@ void Player::on_main_loop(void *argument)
     }
 }
 
+// start reading the newly opened file from the beginning, it may be text or compact binary G-code
+void Player::start_reader()
+{
+    this->compact_file = this->reader->start(this->current_file_handler) && this->compact->start(this->reader);
+}
+
+// plays records from a compact binary file while the queue has room, same as the lines of a text file.
+// returns false once the file has been played
+bool Player::play_compact()
+{
+    StreamOutput *stream = this->current_stream == nullptr ? &(StreamOutput::NullStream) : this->current_stream;
+    string text;
+    size_t len;
+    int fed = 0;
+    while(true) {
+        CompactGcode::RECORD_T r = this->compact->next(this->reader, text, len);
+        played_cnt += len;
+
+        if(r == CompactGcode::END) return false;
+
+        if(r == CompactGcode::BAD) {
+            THEKERNEL->streams->printf("Error: bad record in %s at byte %lu, stopped playing\r\n", this->filename.c_str(), played_cnt);
+            return false;
+        }
+
+        if(r == CompactGcode::MOVE) {
+            // the move is already decoded, so it skips the parsing but is dispatched like a line would be
+            Gcode gcode(this->compact->g, this->compact->params, this->compact->values, stream);
+            if(this->current_stream != nullptr) {
+                this->current_stream->printf("G%u", gcode.g);
+                for (int i = 0; this->compact->params[i] != '\0'; ++i) {
+                    this->current_stream->printf(" %c%1.4f", this->compact->params[i], this->compact->values[i]);
+                }
+                this->current_stream->printf("\n");
+            }
+
+            THEKERNEL->gcode_dispatch->dispatch_decoded(&gcode, stream);
+
+            // the error went to the stream playing the file, which may be nobody
+            if(gcode.is_error) {
+                THEKERNEL->streams->printf("Error: bad move in %s at byte %lu, stopped playing\r\n", this->filename.c_str(), played_cnt);
+                return true;
+            }
+
+        } else {
+            struct SerialMessage message;
+            message.message = text;
+            message.stream = stream;
+
+            if(this->current_stream != nullptr) {
+                this->current_stream->printf("%s\n", text.c_str());
+            }
+
+            THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+        }
+
+        if(!this->playing_file || THEKERNEL->is_halted() || THECONVEYOR->is_queue_full() || ++fed >= 32) return true;
+    }
+}
+
+// read ahead while the planner queue is full and we are waiting for room
+void Player::on_idle(void *argument)
+{
+    if(this->playing_file) this->reader->prefetch();
+}
+
 void Player::on_get_public_data(void *argument)
 {
     PublicDataRequest *pdr = static_cast<PublicDataRequest *>(argument);
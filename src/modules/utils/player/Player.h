@@ -17,6 +17,8 @@
 using std::string;
 
 class StreamOutput;
+class FileLineReader;
+class CompactGcode;
 
 class Player : public Module {
     public:
@@ -25,6 +27,7 @@ class Player : public Module {
         void on_module_loaded();
         void on_console_line_received( void* argument );
         void on_main_loop( void* argument );
+        void on_idle( void* argument );
         void on_second_tick(void* argument);
         void on_get_public_data(void* argument);
         void on_set_public_data(void* argument);
@@ -39,6 +42,8 @@ class Player : public Module {
         void resume_command( string parameters, StreamOutput* stream );
         string extract_options(string& args);
         void suspend_part2();
+        void start_reader();
+        bool play_compact();
 
         string filename;
         string after_suspend_gcode;
@@ -48,6 +53,8 @@ class Player : public Module {
         StreamOutput* reply_stream;
 
         FILE* current_file_handler;
+        FileLineReader* reader;
+        CompactGcode* compact;
         long file_size;
         unsigned long played_cnt;
         unsigned long elapsed_secs;
@@ -61,6 +68,7 @@ class Player : public Module {
             bool was_playing_file:1;
             bool leave_heaters_on:1;
             bool override_leave_heaters_on:1;
+            bool compact_file:1;
             uint8_t suspend_loops:4;
         };
 };
@@ -41,6 +41,7 @@
 #include "md5.h"
 #include "utils.h"
 #include "AutoPushPop.h"
+#include "IsrProfile.h"
 
 #include "system_LPC17xx.h"
 #include "LPC17xx.h"
@@ -89,6 +90,9 @@ const SimpleShell::ptentry_t SimpleShell::commands_table[] = {
     {"thermistors", SimpleShell::print_thermistors_command},
     {"md5sum",   SimpleShell::md5sum_command},
     {"test",     SimpleShell::test_command},
+#ifdef ISR_PROFILE
+    {"profile",  SimpleShell::profile_command},
+#endif
 
     // unknown command
     {NULL, NULL}
@@ -886,7 +890,7 @@ void SimpleShell::get_command( string parameters, StreamOutput *stream)
 
     } else if (what == "status") {
         // also ? on serial and usb
-        stream->printf("%s\n", THEKERNEL->get_query_string().c_str());
+        stream->printf("%s\n", THEKERNEL->get_query_string(stream).c_str());
 
     } else {
         stream->printf("error:unknown option %s\n", what.c_str());
@@ -1028,6 +1032,17 @@ void SimpleShell::md5sum_command( string parameters, StreamOutput *stream )
     fclose(lp);
 }
 
+#ifdef ISR_PROFILE
+// print the interrupt handler timings, see IsrProfile.h
+void SimpleShell::profile_command( string parameters, StreamOutput *stream)
+{
+    IsrProfile::report_all(stream);
+    if(shift_parameter(parameters) == "-r") {
+        IsrProfile::reset_all();
+    }
+}
+#endif
+
 // runs several types of test on the mechanisms
 void SimpleShell::test_command( string parameters, StreamOutput *stream)
 {
@@ -1344,5 +1359,8 @@ void SimpleShell::help_command( string parameters, StreamOutput *stream )
     stream->printf("calc_thermistor [-s0] T1,R1,T2,R2,T3,R3 - calculate the Steinhart Hart coefficients for a thermistor\r\n");
     stream->printf("thermistors - print out the predefined thermistors\r\n");
     stream->printf("md5sum file - prints md5 sum of the given file\r\n");
+#ifdef ISR_PROFILE
+    stream->printf("profile [-r] - prints the cycles spent in interrupt handlers, -r resets them after printing\r\n");
+#endif
 }
 
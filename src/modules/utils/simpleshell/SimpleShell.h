@@ -64,6 +64,9 @@ private:
     static void remount_command( string parameters, StreamOutput *stream);
 
     static void test_command( string parameters, StreamOutput *stream);
+#ifdef ISR_PROFILE
+    static void profile_command( string parameters, StreamOutput *stream);
+#endif
 
     typedef void (*PFUNC)(string parameters, StreamOutput *stream);
     typedef struct {
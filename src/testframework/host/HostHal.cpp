@@ -0,0 +1,115 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+This is part of the host build of the Smoothie motion code, it stands in for the mbed library,
+the LPC17xx peripherals and the linker provided memory pools.
+*/
+
+#include "HostHal.h"
+
+#include "LPC17xx.h"
+#include "us_ticker_api.h"
+#include "wait_api.h"
+#include "MRI_Hooks.h"
+#include "platform_memory.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// the registers are just RAM, three windows cover everything the motion code touches
+static uint8_t gpio_window[0x4000] __attribute__ ((aligned (8)));    // 0x2009C000 GPIO
+static uint8_t apb_window[0x100000] __attribute__ ((aligned (8)));   // 0x40000000 APB0 and APB1
+static uint8_t scs_window[0x1000] __attribute__ ((aligned (8)));     // 0xE000E000 system control space
+
+extern "C" void *host_lpc_reg(uint32_t addr)
+{
+    if(addr >= 0x2009C000UL && addr < 0x2009C000UL + sizeof(gpio_window)) return &gpio_window[addr - 0x2009C000UL];
+    if(addr >= 0x40000000UL && addr < 0x40000000UL + sizeof(apb_window)) return &apb_window[addr - 0x40000000UL];
+    if(addr >= 0xE000E000UL && addr < 0xE000E000UL + sizeof(scs_window)) return &scs_window[addr - 0xE000E000UL];
+
+    fprintf(stderr, "FATAL: no host backing for peripheral address 0x%08X\n", addr);
+    abort();
+}
+
+uint32_t SystemCoreClock = 100000000; // declared extern "C" by system_LPC17xx.h
+
+static uint64_t clock_ns = 0;
+
+void host_clock_advance_ns(uint64_t ns)
+{
+    clock_ns += ns;
+}
+
+uint64_t host_clock_ns()
+{
+    return clock_ns;
+}
+
+extern "C" uint32_t us_ticker_read()
+{
+    return clock_ns / 1000;
+}
+
+extern "C" void wait(float s)
+{
+    host_clock_advance_ns(s * 1e9F);
+}
+
+extern "C" void wait_ms(int ms)
+{
+    host_clock_advance_ns(ms * 1000000ULL);
+}
+
+extern "C" void wait_us(int us)
+{
+    host_clock_advance_ns(us * 1000ULL);
+}
+
+extern "C" void set_high_on_debug(int port, int pin) {}
+extern "C" void set_low_on_debug(int port, int pin) {}
+
+// AHB0 and AHB1 are 16K each on the LPC1768, the host ones are as large as a MemoryPool can be
+// as Blocks are larger with 64 bit pointers and we want to be able to try big queues
+static uint8_t ahb0_ram[0xFFF0] __attribute__ ((aligned (8)));
+static uint8_t ahb1_ram[0xFFF0] __attribute__ ((aligned (8)));
+
+MemoryPool *_AHB0;
+MemoryPool *_AHB1;
+
+void host_memory_init()
+{
+    _AHB0 = new MemoryPool(ahb0_ram, sizeof(ahb0_ram));
+    _AHB1 = new MemoryPool(ahb1_ram, sizeof(ahb1_ram));
+}
+
+uint32_t host_malloc_count = 0;
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__)
+// interpose the allocator so heap traffic per line can be reported, glibc exports the real ones under these names
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *p, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    host_malloc_count++;
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    host_malloc_count++;
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *p, size_t size)
+{
+    host_malloc_count++;
+    return __libc_realloc(p, size);
+}
+#endif
@@ -0,0 +1,22 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+// Simulated clock for the host build.
+// Nothing advances it except the harness (one step ticker period per simulated ISR) and the wait_xx() calls,
+// so us_ticker_read() reports time as the firmware would see it on the board, not host wall time.
+void host_clock_advance_ns(uint64_t ns);
+uint64_t host_clock_ns();
+
+// sets up AHB0 and AHB1 memory pools in host RAM
+void host_memory_init();
+
+// number of calls to malloc, calloc and realloc so far, only counted with glibc and not under AddressSanitizer
+extern uint32_t host_malloc_count;
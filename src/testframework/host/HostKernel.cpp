@@ -0,0 +1,145 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+This is part of the host build of the Smoothie motion code, like the test framework kernel it only
+sets up what the motion code needs: config, streams, step ticker, conveyor, gcode dispatch, robot and planner.
+*/
+
+#include "libs/Kernel.h"
+#include "libs/Module.h"
+#include "libs/Config.h"
+#include "libs/StreamOutputPool.h"
+#include "checksumm.h"
+#include "ConfigValue.h"
+#include "FirmConfigSource.h"
+
+#include "libs/StepTicker.h"
+#include "modules/robot/Planner.h"
+#include "modules/robot/Robot.h"
+#include "modules/robot/Conveyor.h"
+#include "modules/communication/GcodeDispatch.h"
+#include "SimpleShell.h"
+
+#include <stdio.h>
+#include <string>
+
+#define base_stepping_frequency_checksum CHECKSUM("base_stepping_frequency")
+#define microseconds_per_step_pulse_checksum CHECKSUM("microseconds_per_step_pulse")
+
+Kernel* Kernel::instance;
+
+// console output goes to stdout
+class HostStreamOutput : public StreamOutput {
+    public:
+        int puts(const char* str) { return fputs(str, stdout); }
+};
+
+// The kernel is the central point in Smoothie : it stores modules, and handles event calls
+Kernel::Kernel(){
+    instance= this; // setup the Singleton instance of the kernel
+
+    halted = false;
+    feed_hold = false;
+    enable_feed_hold = false;
+    bad_mcu = false;
+    canceled = false;
+    use_leds = false;
+    grbl_mode = false;
+    ok_per_line = true;
+    report_buffers = false;
+
+    // loaded by host_kernel_setup()
+    this->config = nullptr;
+
+    this->streams = new StreamOutputPool();
+    this->streams->append_stream(new HostStreamOutput());
+
+    this->current_path   = "/";
+
+    this->serial = nullptr;
+    this->gcode_dispatch = nullptr;
+    this->configurator = nullptr;
+    this->simpleshell = nullptr;
+    this->slow_ticker = nullptr;
+    this->adc = nullptr;
+}
+
+// Add a module to Kernel. We don't actually hold a list of modules we just call its on_module_loaded
+void Kernel::add_module(Module* module){
+    module->on_module_loaded();
+}
+
+// Adds a hook for a given module and event
+void Kernel::register_for_event(_EVENT_ENUM id_event, Module *mod){
+    this->hooks[id_event].push_back(mod);
+}
+
+// Call a specific event with an argument
+void Kernel::call_event(_EVENT_ENUM id_event, void * argument){
+    if (id_event == ON_HALT) {
+        this->halted = (argument == nullptr);
+    }
+
+    for (auto m : hooks[id_event]) {
+        (m->*kernel_callback_functions[id_event])(argument);
+    }
+}
+
+bool Kernel::kernel_has_event(_EVENT_ENUM id_event, Module *mod)
+{
+    for (auto m : hooks[id_event]) {
+        if(m == mod) return true;
+    }
+    return false;
+}
+
+void Kernel::unregister_for_event(_EVENT_ENUM id_event, Module *mod)
+{
+    for (auto i = hooks[id_event].begin(); i != hooks[id_event].end(); ++i) {
+        if(*i == mod) {
+            hooks[id_event].erase(i);
+            return;
+        }
+    }
+}
+
+// the shell is not part of the host build, GcodeDispatch only passes M501, M504 and M1000 to it
+bool SimpleShell::parse_command(const char *cmd, string args, StreamOutput *stream)
+{
+    return false;
+}
+
+std::string Kernel::get_query_string(StreamOutput *stream)
+{
+    return std::string("<Sim>\n");
+}
+
+// same order as the firmware Kernel constructor and main() for the modules we build
+void host_kernel_setup(const char* start, const char* end)
+{
+    THEKERNEL->config= new Config(new FirmConfigSource("sim", start, end) );
+    THEKERNEL->config->config_cache_load();
+
+    THEKERNEL->step_ticker = new StepTicker();
+
+    THEKERNEL->base_stepping_frequency = THEKERNEL->config->value(base_stepping_frequency_checksum)->by_default(100000)->as_number();
+    float microseconds_per_step_pulse = THEKERNEL->config->value(microseconds_per_step_pulse_checksum)->by_default(1)->as_number();
+    THEKERNEL->step_ticker->set_frequency(THEKERNEL->base_stepping_frequency);
+    THEKERNEL->step_ticker->set_unstep_time(microseconds_per_step_pulse);
+
+    THEKERNEL->add_module(THEKERNEL->conveyor = new Conveyor());
+    THEKERNEL->add_module(THEKERNEL->gcode_dispatch = new GcodeDispatch());
+    THEKERNEL->add_module(THEKERNEL->robot = new Robot());
+    THEKERNEL->planner = new Planner();
+
+    // main() clears the config cache once every module has read it
+    THEKERNEL->config->config_cache_clear();
+
+    THECONVEYOR->start(THEROBOT->get_number_registered_motors());
+    THEKERNEL->step_ticker->start();
+}
@@ -0,0 +1,266 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/**
+planner_sim replays a G-code file through the real GcodeDispatch, Robot, Planner, Conveyor and StepTicker on the host.
+
+The step ticker ISRs are run from ON_IDLE, ticks_per_idle at a time, advancing the simulated clock one step
+period per tick, so the planner sees the queue drain the way it would on the board whenever it waits for room.
+Host time spent planning and host time spent in the simulated ISRs are measured separately.
+*/
+
+#include "libs/Kernel.h"
+#include "libs/Module.h"
+#include "libs/StepTicker.h"
+#include "libs/StreamOutput.h"
+#include "libs/SerialMessage.h"
+#include "modules/robot/Conveyor.h"
+#include "modules/robot/Robot.h"
+#include "libs/StepperMotor.h"
+#include "HostHal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <chrono>
+#include <string>
+
+extern void host_kernel_setup(const char* start, const char* end);
+extern "C" void TIMER0_IRQHandler(void);
+extern "C" void TIMER1_IRQHandler(void);
+
+typedef std::chrono::steady_clock sim_clock;
+
+static uint64_t elapsed_ns(sim_clock::time_point since)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(sim_clock::now() - since).count();
+}
+
+// the motion section of ConfigSamples/STEBoard/STE530-20-12-config.txt, XYZ plus the ABC rotary axes
+static const char default_config[] =
+    "arm_solution corexy\n"
+    "default_feed_rate 4000\n"
+    "default_seek_rate 4000\n"
+    "mm_per_arc_segment 0.0\n"
+    "mm_max_arc_error 0.01\n"
+    "alpha_steps_per_mm 640\n"
+    "beta_steps_per_mm 640\n"
+    "gamma_steps_per_mm 800\n"
+    "delta_steps_per_mm 26.66667\n"
+    "epsilon_steps_per_mm 26.66667\n"
+    "zeta_steps_per_mm 80\n"
+    "acceleration 1000\n"
+    "junction_deviation 0.001\n"
+    "z_junction_deviation 0.001\n"
+    "x_axis_max_speed 12000\n"
+    "y_axis_max_speed 12000\n"
+    "z_axis_max_speed 1500\n"
+    "alpha_step_pin 2.0\n"
+    "alpha_dir_pin 0.5\n"
+    "alpha_en_pin 0.4\n"
+    "alpha_max_rate 9000.0\n"
+    "beta_step_pin 2.1\n"
+    "beta_dir_pin 0.11\n"
+    "beta_en_pin 0.10\n"
+    "beta_max_rate 9000.0\n"
+    "gamma_step_pin 2.2\n"
+    "gamma_dir_pin 0.20!\n"
+    "gamma_en_pin 0.19\n"
+    "gamma_max_rate 1500.0\n"
+    "delta_step_pin 1.15\n"
+    "delta_dir_pin 1.14\n"
+    "delta_en_pin 1.16\n"
+    "delta_max_rate 7200.0\n"
+    "epsilon_step_pin 2.11\n"
+    "epsilon_dir_pin 0.28!\n"
+    "epsilon_en_pin 2.12\n"
+    "epsilon_max_rate 7200.0\n"
+    "zeta_step_pin 1.18\n"
+    "zeta_dir_pin 1.17!\n"
+    "zeta_en_pin 1.19\n"
+    "zeta_max_rate 7200.0\n";
+
+static struct {
+    uint32_t count;
+    uint32_t coalesced;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    sim_clock::time_point start;
+} recalc_stats;
+
+void planner_sim_recalculate_begin()
+{
+    recalc_stats.start = sim_clock::now();
+}
+
+void planner_sim_recalculate_end()
+{
+    uint64_t ns = elapsed_ns(recalc_stats.start);
+    recalc_stats.count++;
+    recalc_stats.total_ns += ns;
+    if(ns > recalc_stats.max_ns) recalc_stats.max_ns = ns;
+}
+
+void planner_sim_recalculate_coalesced()
+{
+    recalc_stats.coalesced++;
+}
+
+// Runs the step ticker in place of the timer interrupts
+class TickSimulator : public Module {
+    public:
+        TickSimulator(uint32_t ticks_per_idle) : ticks_per_idle(ticks_per_idle) {}
+
+        void on_module_loaded()
+        {
+            period_ns = 1e9F / THEKERNEL->step_ticker->get_frequency();
+            register_for_event(ON_IDLE);
+        }
+
+        void on_idle(void *)
+        {
+            sim_clock::time_point start = sim_clock::now();
+            for (uint32_t i = 0; i < ticks_per_idle; ++i) {
+                TIMER0_IRQHandler();
+                TIMER1_IRQHandler();
+                host_clock_advance_ns(period_ns);
+
+                if(THEKERNEL->step_ticker->get_current_block() != nullptr) {
+                    active_ticks++;
+                    started = true;
+                } else if(started && streaming) {
+                    // the queue ran dry while there was still G-code to plan
+                    starved_ticks++;
+                }
+            }
+            tick_ns += elapsed_ns(start);
+            total_ticks += ticks_per_idle;
+        }
+
+        uint32_t ticks_per_idle;
+        uint64_t period_ns{0};
+        uint64_t tick_ns{0};
+        uint64_t total_ticks{0};
+        uint64_t active_ticks{0};
+        uint64_t starved_ticks{0};
+        bool started{false};
+        bool streaming{true};
+};
+
+static void usage(const char *name)
+{
+    fprintf(stderr, "Usage: %s [-c config] [-s \"setting value\"]... [-q planner_queue_size] [-f base_stepping_frequency] [-t ticks_per_idle] file.gcode\n", name);
+    exit(1);
+}
+
+int main(int argc, char *argv[])
+{
+    const char *config_file = nullptr;
+    const char *queue_size = nullptr;
+    const char *frequency = nullptr;
+    uint32_t ticks_per_idle = 100;
+    std::string settings;
+
+    int c;
+    while ((c = getopt(argc, argv, "c:s:q:f:t:")) != -1) {
+        switch (c) {
+            case 'c': config_file = optarg; break;
+            case 's': settings.append(optarg).append("\n"); break;
+            case 'q': queue_size = optarg; break;
+            case 'f': frequency = optarg; break;
+            case 't': ticks_per_idle = strtoul(optarg, nullptr, 10); break;
+            default: usage(argv[0]);
+        }
+    }
+    if (optind != argc - 1 || ticks_per_idle == 0) usage(argv[0]);
+
+    FILE *gcode_file = fopen(argv[optind], "r");
+    if (gcode_file == nullptr) {
+        fprintf(stderr, "Cannot open %s\n", argv[optind]);
+        return 1;
+    }
+
+    std::string config;
+    if (config_file != nullptr) {
+        FILE *fp = fopen(config_file, "r");
+        if (fp == nullptr) {
+            fprintf(stderr, "Cannot open %s\n", config_file);
+            return 1;
+        }
+        char buf[256];
+        while (fgets(buf, sizeof(buf), fp) != nullptr) config.append(buf);
+        fclose(fp);
+        if (!config.empty() && config.back() != '\n') config.append("\n");
+    } else {
+        config = default_config;
+    }
+    // the last occurrence of a setting wins, so overrides go at the end
+    config.append(settings);
+    if (queue_size != nullptr) config.append(std::string("planner_queue_size ") + queue_size + "\n");
+    if (frequency != nullptr) config.append(std::string("base_stepping_frequency ") + frequency + "\n");
+
+    host_memory_init();
+    new Kernel();
+    host_kernel_setup(config.data(), config.data() + config.size());
+
+    TickSimulator *sim = new TickSimulator(ticks_per_idle);
+    THEKERNEL->add_module(sim);
+
+    uint32_t lines = 0;
+    char buf[256];
+
+    // each line is sent the way SerialConsole does, without the newline
+    SerialMessage message;
+    message.stream = &StreamOutput::NullStream;
+
+    uint32_t mallocs = host_malloc_count;
+    sim_clock::time_point start = sim_clock::now();
+    while (fgets(buf, sizeof(buf), gcode_file) != nullptr) {
+        lines++;
+        size_t n = strcspn(buf, "\n");
+        message.message.assign(buf, n);
+        THEKERNEL->call_event(ON_CONSOLE_LINE_RECEIVED, &message);
+        THEKERNEL->call_event(ON_MAIN_LOOP);
+        THEKERNEL->call_event(ON_IDLE);
+    }
+    uint64_t stream_ns = elapsed_ns(start);
+    uint64_t stream_tick_ns = sim->tick_ns;
+    mallocs = host_malloc_count - mallocs;
+    sim->streaming = false;
+
+    THECONVEYOR->wait_for_idle();
+    fclose(gcode_file);
+
+    // planning time is everything spent streaming apart from the simulated ISRs
+    double plan_s = (stream_ns - stream_tick_ns) / 1e9;
+    double sim_s = host_clock_ns() / 1e9;
+    uint32_t blocks = recalc_stats.count - recalc_stats.coalesced;
+
+    printf("lines:                  %u\n", lines);
+    printf("blocks planned:         %u\n", blocks);
+    printf("moves coalesced:        %u\n", recalc_stats.coalesced);
+    printf("planner queue size:     %u\n", (unsigned)THECONVEYOR->get_queue_size());
+    printf("step frequency:         %1.0f Hz\n", THEKERNEL->step_ticker->get_frequency());
+    printf("host planning time:     %1.3f s\n", plan_s);
+    printf("lines/sec:              %1.0f\n", plan_s > 0 ? lines / plan_s : 0);
+    printf("blocks/sec:             %1.0f\n", plan_s > 0 ? blocks / plan_s : 0);
+    printf("heap allocs per line:   %1.2f\n", lines > 0 ? (double)mallocs / lines : 0);
+    printf("recalculate avg:        %1.2f us\n", recalc_stats.count > 0 ? recalc_stats.total_ns / 1e3 / recalc_stats.count : 0);
+    printf("recalculate max:        %1.2f us\n", recalc_stats.max_ns / 1e3);
+    printf("ISR ticks per block:    %1.1f\n", blocks > 0 ? (double)sim->active_ticks / blocks : 0);
+    printf("host ns per tick:       %1.1f\n", sim->total_ticks > 0 ? (double)sim->tick_ns / sim->total_ticks : 0);
+    printf("simulated job time:     %1.3f s\n", sim_s);
+    printf("starved ticks:          %llu (%1.3f s)\n", (unsigned long long)sim->starved_ticks, sim->starved_ticks * sim->period_ns / 1e9);
+    printf("final actuator steps:  ");
+    for (size_t i = 0; i < THEROBOT->get_number_registered_motors(); i++) {
+        printf(" %ld", (long)(int32_t)THEROBOT->actuators[i]->get_current_step());
+    }
+    printf("\n");
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+// Host build: pin interrupts are never fired, only constructed by Pin::interrupt_pin()
+#pragma once
+#include "PinNames.h"
+
+namespace mbed {
+class InterruptIn {
+public:
+    InterruptIn(PinName) {}
+};
+}
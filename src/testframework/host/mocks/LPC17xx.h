@@ -0,0 +1,4 @@
+// Host build: the mbed CMSIS device header is the same register map as the smoothed copy
+#pragma once
+#include <libs/LPC17xx/sLPC17xx.h>
+#include "system_LPC17xx.h"
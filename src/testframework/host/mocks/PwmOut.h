@@ -0,0 +1,12 @@
+// Host build: hardware PWM is never started, only constructed by Pin::hardware_pwm()
+#pragma once
+#include "PinNames.h"
+
+namespace mbed {
+class PwmOut {
+public:
+    PwmOut(PinName) {}
+    void write(float) {}
+    void period_us(int) {}
+};
+}
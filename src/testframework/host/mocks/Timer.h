@@ -0,0 +1,3 @@
+// Host build: nothing under test uses mbed::Timer directly
+#pragma once
+#include "us_ticker_api.h"
@@ -0,0 +1,2 @@
+// Host build replacement for the mbed cmsis.h
+#include "LPC17xx.h"
@@ -0,0 +1,3 @@
+// Host build: newlib's fastmath.h is just math.h with optional fast variants
+#pragma once
+#include <math.h>
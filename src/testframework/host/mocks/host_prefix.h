@@ -0,0 +1,12 @@
+// Host build: force included before every source.
+// The firmware relies on newlib headers pulling these in transitively, glibc does not.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+#include <vector>
+#include <string>
+#endif
@@ -0,0 +1,149 @@
+/*
+      This file is part of Smoothie (http://smoothieware.org/). The motion control part is heavily based on Grbl (https://github.com/simen/grbl).
+      Smoothie is free software: you can redistribute it and/or modify it under the terms of the GNU General Public License as published by the Free Software Foundation, either version 3 of the License, or (at your option) any later version.
+      Smoothie is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License for more details.
+      You should have received a copy of the GNU General Public License along with Smoothie. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+// Host build of the LPC17xx register map.
+// Pulls in the real register layout and then redirects the peripherals the motion code touches into
+// plain host memory, so code that pokes GPIO or timer registers simply writes into RAM.
+
+#ifndef HOST_SLPC17XX_H
+#define HOST_SLPC17XX_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+// park the Cortex-M intrinsics and the core functions that dereference the fixed register
+// addresses under other names, they are replaced with host versions below
+#define __enable_irq __arm__enable_irq
+#define __disable_irq __arm__disable_irq
+#define __enable_fault_irq __arm__enable_fault_irq
+#define __disable_fault_irq __arm__disable_fault_irq
+#define __NOP __arm__NOP
+#define __WFI __arm__WFI
+#define __WFE __arm__WFE
+#define __SEV __arm__SEV
+#define __ISB __arm__ISB
+#define __DSB __arm__DSB
+#define __DMB __arm__DMB
+#define __CLREX __arm__CLREX
+#define NVIC_SystemReset __arm_NVIC_SystemReset
+#define NVIC_SetPriorityGrouping __arm_NVIC_SetPriorityGrouping
+#define NVIC_GetPriorityGrouping __arm_NVIC_GetPriorityGrouping
+#define NVIC_EnableIRQ __arm_NVIC_EnableIRQ
+#define NVIC_DisableIRQ __arm_NVIC_DisableIRQ
+#define NVIC_GetPendingIRQ __arm_NVIC_GetPendingIRQ
+#define NVIC_SetPendingIRQ __arm_NVIC_SetPendingIRQ
+#define NVIC_ClearPendingIRQ __arm_NVIC_ClearPendingIRQ
+#define NVIC_GetActive __arm_NVIC_GetActive
+#define NVIC_SetPriority __arm_NVIC_SetPriority
+#define NVIC_GetPriority __arm_NVIC_GetPriority
+#define SysTick_Config __arm_SysTick_Config
+
+#include_next "libs/LPC17xx/sLPC17xx.h"
+
+#undef __enable_irq
+#undef __disable_irq
+#undef __enable_fault_irq
+#undef __disable_fault_irq
+#undef __NOP
+#undef __WFI
+#undef __WFE
+#undef __SEV
+#undef __ISB
+#undef __DSB
+#undef __DMB
+#undef __CLREX
+#undef NVIC_SystemReset
+#undef NVIC_SetPriorityGrouping
+#undef NVIC_GetPriorityGrouping
+#undef NVIC_EnableIRQ
+#undef NVIC_DisableIRQ
+#undef NVIC_GetPendingIRQ
+#undef NVIC_SetPendingIRQ
+#undef NVIC_ClearPendingIRQ
+#undef NVIC_GetActive
+#undef NVIC_SetPriority
+#undef NVIC_GetPriority
+#undef SysTick_Config
+
+// there is no concurrent ISR on the host, the step ticker is called synchronously
+static inline void __enable_irq() {}
+static inline void __disable_irq() {}
+static inline void __enable_fault_irq() {}
+static inline void __disable_fault_irq() {}
+static inline void __NOP() {}
+static inline void __WFI() {}
+static inline void __WFE() {}
+static inline void __SEV() {}
+static inline void __ISB() {}
+static inline void __DSB() {}
+static inline void __DMB() {}
+static inline void __CLREX() {}
+static inline void NVIC_SystemReset() { abort(); }
+
+// interrupts are never enabled on the host, the harness calls the handlers itself
+static inline void NVIC_SetPriorityGrouping(uint32_t PriorityGroup) {}
+static inline uint32_t NVIC_GetPriorityGrouping(void) { return 0; }
+static inline void NVIC_EnableIRQ(IRQn_Type IRQn) {}
+static inline void NVIC_DisableIRQ(IRQn_Type IRQn) {}
+static inline uint32_t NVIC_GetPendingIRQ(IRQn_Type IRQn) { return 0; }
+static inline void NVIC_SetPendingIRQ(IRQn_Type IRQn) {}
+static inline void NVIC_ClearPendingIRQ(IRQn_Type IRQn) {}
+static inline uint32_t NVIC_GetActive(IRQn_Type IRQn) { return 0; }
+static inline void NVIC_SetPriority(IRQn_Type IRQn, uint32_t priority) {}
+static inline uint32_t NVIC_GetPriority(IRQn_Type IRQn) { return 0; }
+static inline uint32_t SysTick_Config(uint32_t ticks, bool enable_irq) { return 0; }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+// backing store for the GPIO, APB peripheral and system control address windows, see HostHal.cpp
+void *host_lpc_reg(uint32_t addr);
+#ifdef __cplusplus
+}
+#endif
+
+#define HOST_LPC_REG(type, addr) ((type *) host_lpc_reg(addr))
+
+#undef LPC_SC
+#undef LPC_GPIO0
+#undef LPC_GPIO1
+#undef LPC_GPIO2
+#undef LPC_GPIO3
+#undef LPC_GPIO4
+#undef LPC_WDT
+#undef LPC_TIM0
+#undef LPC_TIM1
+#undef LPC_TIM2
+#undef LPC_TIM3
+#undef LPC_GPIOINT
+#undef LPC_PINCON
+#undef LPC_PWM1
+#undef SCB
+#undef SysTick
+#undef NVIC
+#undef CoreDebug
+
+#define LPC_SC          HOST_LPC_REG(LPC_SC_TypeDef,      LPC_SC_BASE)
+#define LPC_GPIO0       HOST_LPC_REG(LPC_GPIO_TypeDef,    LPC_GPIO0_BASE)
+#define LPC_GPIO1       HOST_LPC_REG(LPC_GPIO_TypeDef,    LPC_GPIO1_BASE)
+#define LPC_GPIO2       HOST_LPC_REG(LPC_GPIO_TypeDef,    LPC_GPIO2_BASE)
+#define LPC_GPIO3       HOST_LPC_REG(LPC_GPIO_TypeDef,    LPC_GPIO3_BASE)
+#define LPC_GPIO4       HOST_LPC_REG(LPC_GPIO_TypeDef,    LPC_GPIO4_BASE)
+#define LPC_WDT         HOST_LPC_REG(LPC_WDT_TypeDef,     LPC_WDT_BASE)
+#define LPC_TIM0        HOST_LPC_REG(LPC_TIM_TypeDef,     LPC_TIM0_BASE)
+#define LPC_TIM1        HOST_LPC_REG(LPC_TIM_TypeDef,     LPC_TIM1_BASE)
+#define LPC_TIM2        HOST_LPC_REG(LPC_TIM_TypeDef,     LPC_TIM2_BASE)
+#define LPC_TIM3        HOST_LPC_REG(LPC_TIM_TypeDef,     LPC_TIM3_BASE)
+#define LPC_GPIOINT     HOST_LPC_REG(LPC_GPIOINT_TypeDef, LPC_GPIOINT_BASE)
+#define LPC_PINCON      HOST_LPC_REG(LPC_PINCON_TypeDef,  LPC_PINCON_BASE)
+#define LPC_PWM1        HOST_LPC_REG(LPC_PWM_TypeDef,     LPC_PWM1_BASE)
+#define SCB             HOST_LPC_REG(SCB_Type,            SCB_BASE)
+#define SysTick         HOST_LPC_REG(SysTick_Type,        SysTick_BASE)
+#define NVIC            HOST_LPC_REG(NVIC_Type,           NVIC_BASE)
+#define CoreDebug       HOST_LPC_REG(CoreDebug_Type,      CoreDebug_BASE)
+
+#endif
@@ -0,0 +1,11 @@
+// Host build replacement for mbed.h, only the handful of calls the motion code makes
+#pragma once
+
+#include <stdint.h>
+#include "cmsis.h"
+#include "PinNames.h"
+#include "us_ticker_api.h"
+#include "wait_api.h"
+
+// as the real mbed.h does
+using namespace std;
@@ -0,0 +1,6 @@
+// Host build replacement for the MRI debug monitor header
+#pragma once
+
+#include <stdlib.h>
+
+#define __debugbreak()  { abort(); }
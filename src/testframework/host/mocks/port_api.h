@@ -0,0 +1,6 @@
+// Host build: only the pin name lookup used by Pin::interrupt_pin()
+#pragma once
+#include "PinNames.h"
+#include "PortNames.h"
+
+static inline PinName port_pin(PortName port, int pin_n) { return (PinName)(LPC_GPIO0_BASE + ((port << PORT_SHIFT) | pin_n)); }
@@ -0,0 +1,2 @@
+// Host build: some sources include the smoothed register map without its directory
+#include <libs/LPC17xx/sLPC17xx.h>
@@ -0,0 +1,6 @@
+// Host build replacement for the CMSIS system header
+#pragma once
+#include <stdint.h>
+#include "LPC17xx.h"
+
+extern "C" uint32_t SystemCoreClock;
@@ -0,0 +1,5 @@
+// Host build: the microsecond ticker reads the simulated clock
+#pragma once
+#include <stdint.h>
+
+extern "C" uint32_t us_ticker_read(void);
@@ -0,0 +1,8 @@
+// Host build: waits advance the simulated clock instead of spinning
+#pragma once
+
+extern "C" {
+void wait(float s);
+void wait_ms(int ms);
+void wait_us(int us);
+}
@@ -0,0 +1,88 @@
+#include "LineRingBuffer.h"
+
+#include <string>
+
+#include "easyunit/test.h"
+
+static void put_str(LineRingBuffer &rb, const char *s)
+{
+    while(*s) rb.put(*s++);
+}
+
+TEST(LineRingBufferTest,lines)
+{
+    LineRingBuffer rb;
+    ASSERT_TRUE(rb.allocate(32));
+
+    std::string line;
+    put_str(rb, "G1 X1\nG1");
+    ASSERT_TRUE(rb.lines() == 1);
+    ASSERT_TRUE(rb.get_line(line));
+    ASSERT_TRUE(line == "G1 X1");
+    ASSERT_TRUE(!rb.get_line(line));
+
+    put_str(rb, " Y2\r\n");
+    ASSERT_TRUE(rb.lines() == 2);
+    ASSERT_TRUE(rb.get_line(line));
+    ASSERT_TRUE(line == "G1 Y2");
+    ASSERT_TRUE(rb.get_line(line));
+    ASSERT_TRUE(line.empty());
+}
+
+TEST(LineRingBufferTest,wraps)
+{
+    LineRingBuffer rb;
+    ASSERT_TRUE(rb.allocate(16));
+
+    std::string line;
+    for (int i = 0; i < 20; ++i) {
+        put_str(rb, "M114 S1\n");
+        ASSERT_TRUE(rb.get_line(line));
+        ASSERT_TRUE(line == "M114 S1");
+        ASSERT_TRUE(rb.available() == 0);
+    }
+}
+
+TEST(LineRingBufferTest,full_and_backspace)
+{
+    LineRingBuffer rb;
+    ASSERT_TRUE(rb.allocate(8));
+
+    put_str(rb, "abcdefgh");
+    ASSERT_TRUE(rb.free() == 0);
+    ASSERT_TRUE(!rb.put('\n'));
+
+    rb.unput();
+    ASSERT_TRUE(rb.put('\n'));
+
+    std::string line;
+    ASSERT_TRUE(rb.get_line(line));
+    ASSERT_TRUE(line == "abcdef");
+
+    // backspace does not go back past a complete line
+    put_str(rb, "x\n");
+    rb.unput();
+    ASSERT_TRUE(rb.get_line(line));
+    ASSERT_TRUE(line == "x");
+}
+
+TEST(LineRingBufferTest,drop_partial_and_get_char)
+{
+    LineRingBuffer rb;
+    ASSERT_TRUE(rb.allocate(32));
+
+    put_str(rb, "G0\nlong");
+    rb.drop_partial();
+    put_str(rb, "G1\n");
+
+    char c;
+    ASSERT_TRUE(rb.get_char(c) && c == 'G');
+    ASSERT_TRUE(rb.get_char(c) && c == '0');
+    ASSERT_TRUE(rb.get_char(c) && c == '\n');
+    ASSERT_TRUE(rb.lines() == 1);
+
+    std::string line;
+    ASSERT_TRUE(rb.get_line(line));
+    ASSERT_TRUE(line == "G1");
+    ASSERT_TRUE(!rb.get_char(c));
+}
@@ -60,3 +60,68 @@ TEST(GCodeTest,subcode)
     ASSERT_EQUALS_DELTA_V(2.3, gc4.get_value('Y'), 0.001);
 
 }
+
+TEST(GCodeTest,words)
+{
+    Gcode gc1("G1 X1.5 Y-2 Z.25 A10 B-3.5 E0.1 F3000", nullptr);
+    ASSERT_TRUE(gc1.has_g);
+    ASSERT_EQUALS_V(1, gc1.g);
+    ASSERT_TRUE(!gc1.has_letter('C'));
+    ASSERT_TRUE(!gc1.has_letter('G')); // stripped
+    ASSERT_EQUALS_DELTA_V(1.5, gc1.get_value('X'), 0.0001);
+    ASSERT_EQUALS_DELTA_V(-2.0, gc1.get_value('Y'), 0.0001);
+    ASSERT_EQUALS_DELTA_V(0.25, gc1.get_value('Z'), 0.0001);
+    ASSERT_EQUALS_DELTA_V(10.0, gc1.get_value('A'), 0.0001);
+    ASSERT_EQUALS_DELTA_V(-3.5, gc1.get_value('B'), 0.0001);
+    ASSERT_EQUALS_DELTA_V(0.1, gc1.get_value('E'), 0.0001);
+    ASSERT_EQUALS_V(3000, gc1.get_int('F'));
+    ASSERT_EQUALS_V(0, gc1.get_int('Z')); // .25 is not an integer
+    ASSERT_EQUALS_DELTA_V(0.0, gc1.get_value('C'), 0.0001);
+
+    // the first occurrence that has a number wins
+    Gcode gc2("M117 S X5 S12 X7", nullptr);
+    ASSERT_TRUE(gc2.has_m);
+    ASSERT_EQUALS_V(117, gc2.m);
+    ASSERT_TRUE(gc2.has_letter('S'));
+    ASSERT_EQUALS_V(12, gc2.get_uint('S'));
+    ASSERT_EQUALS_DELTA_V(5.0, gc2.get_value('X'), 0.0001);
+
+    // more words than fit in the table
+    Gcode gc3("G1 A1 B2 C3 D4 E5 F6 H7 I8 J9 K10 L11 N12 O13 P14 Q15", nullptr);
+    ASSERT_EQUALS_V(15, gc3.get_num_args());
+    ASSERT_EQUALS_V(1, gc3.get_int('A'));
+    ASSERT_EQUALS_V(15, gc3.get_int('Q'));
+    ASSERT_EQUALS_DELTA_V(14.0, gc3.get_value('P'), 0.0001);
+    Gcode gc4(gc3);
+    ASSERT_EQUALS_V(13, gc4.get_int('O'));
+
+    // table is rebuilt when parameters are stripped
+    Gcode gc5("G1 X10 Y20 E5 F100", nullptr);
+    gc5.strip_parameters();
+    ASSERT_TRUE(!gc5.has_letter('X'));
+    ASSERT_TRUE(!gc5.has_letter('Y'));
+    ASSERT_EQUALS_DELTA_V(5.0, gc5.get_value('E'), 0.0001);
+    ASSERT_EQUALS_V(100, gc5.get_int('F'));
+}
+
+TEST(GCodeTest,decoded)
+{
+    char params[]= "XYF";
+    float values[]= {1.5F, -2.25F, 3000};
+    Gcode gc1(1, params, values, nullptr);
+
+    ASSERT_TRUE(gc1.has_g);
+    ASSERT_TRUE(!gc1.has_m);
+    ASSERT_EQUALS_V(1, gc1.g);
+    ASSERT_EQUALS_V(3, gc1.get_num_args());
+    ASSERT_TRUE(gc1.has_letter('X'));
+    ASSERT_TRUE(!gc1.has_letter('Z'));
+    ASSERT_EQUALS_DELTA_V(1.5, gc1.get_value('X'), 0.001);
+    ASSERT_EQUALS_DELTA_V(-2.25, gc1.get_value('Y'), 0.001);
+    ASSERT_EQUALS_V(3000, gc1.get_int('F'));
+
+    // a copy keeps the values
+    Gcode gc2(gc1);
+    ASSERT_EQUALS_DELTA_V(-2.25, gc2.get_value('Y'), 0.001);
+    ASSERT_EQUALS_V(3000, gc2.get_uint('F'));
+}